@@ -4,16 +4,42 @@
 
 #include <Arduino.h>
 #include <string.h>
+#include <stdarg.h>
 
 /**
  * @file Debugger.h
  * @brief Singleton debug utility for Arduino with per-section verbosity levels and runtime control via serial commands.
  */
 
-/// Default list of all possible debug sections (comma-separated)
-static const char *DEFAULT_SECTIONS = "Accel,Microphone,LED_Control";
-/// Maximum number of sections supported
-static const uint8_t MAX_SECTIONS = 5;
+/// All debug sections, registered at compile time. Format: X(ENUM_NAME, "Serial name")
+#define DEBUG_SECTION_LIST(X)     \
+    X(ACCEL, "Accel")             \
+    X(MICROPHONE, "Microphone")   \
+    X(LED_CONTROL, "LED_Control") \
+    X(TEMP, "Temp")
+// * When you add a debug section, add its X macro line here. *
+
+/// Section identifiers (DBG_ACCEL, DBG_MICROPHONE, ...) used by DBG_LOG and DBG.print
+enum DebugSection : uint8_t
+{
+#define DEBUG_SECTION_ENUM(name, label) DBG_##name,
+    DEBUG_SECTION_LIST(DEBUG_SECTION_ENUM)
+#undef DEBUG_SECTION_ENUM
+        DBG_SECTION_COUNT
+};
+
+/// Highest level compiled into DBG_LOG call sites; anything above is removed at build time
+#ifndef DEBUG_MAX_LEVEL
+#define DEBUG_MAX_LEVEL 3
+#endif
+
+/// Size of the ring buffer DBG_LOG writes into (drained by Debugger::drain())
+#ifndef DEBUG_LOG_BUFFER_SIZE
+#define DEBUG_LOG_BUFFER_SIZE 1024
+#endif
+
+/// Longest single formatted DBG_LOG line, including the "[section] " prefix
+static const uint8_t DEBUG_LOG_LINE_MAX = 128;
 
 /**
  * @class Debugger
@@ -67,40 +93,83 @@ public:
         return _defaultLevel;
     }
 
+    /**
+     * @brief Display name of a section.
+     * @param section Section id.
+     */
+    static const char *sectionName(DebugSection section)
+    {
+        static const char *const names[DBG_SECTION_COUNT] = {
+#define DEBUG_SECTION_NAME(name, label) label,
+            DEBUG_SECTION_LIST(DEBUG_SECTION_NAME)
+#undef DEBUG_SECTION_NAME
+        };
+        return (section < DBG_SECTION_COUNT) ? names[section] : "?";
+    }
+
+    /**
+     * @brief Resolve a section name (case-insensitive) to its id.
+     * @param name Section name as typed on the serial port.
+     * @return Section id, or -1 if no section has that name.
+     */
+    static int findSection(const char *name)
+    {
+        for (uint8_t i = 0; i < DBG_SECTION_COUNT; ++i)
+        {
+            if (namesEqual(sectionName((DebugSection)i), name))
+                return i;
+        }
+        return -1;
+    }
+
     /**
      * @brief Set verbosity level for a specific section.
-     * @param section Section name.
+     * @param section Section id.
      * @param level New level for the section.
      */
-    void setSectionLevel(const char *section, uint8_t level)
+    void setSectionLevel(DebugSection section, uint8_t level)
     {
-        int idx = findSectionIndex(section);
+        if (section >= DBG_SECTION_COUNT)
+            return;
+        _sectionLevels[section] = level;
+        Serial.print("Section '");
+        Serial.print(sectionName(section));
+        Serial.print("' level set to: ");
+        Serial.println(level);
+    }
+
+    /**
+     * @brief Set verbosity level for a section by name (serial command path).
+     * @param name Section name.
+     * @param level New level for the section.
+     */
+    void setSectionLevel(const char *name, uint8_t level)
+    {
+        int idx = findSection(name);
         if (idx >= 0)
         {
-            _sectionLevels[idx] = level;
-            Serial.print("Section '");
-            Serial.print(section);
-            Serial.print("' level set to: ");
-            Serial.println(level);
+            setSectionLevel((DebugSection)idx, level);
+            return;
         }
+        Serial.print("Unknown debug section: ");
+        Serial.println(name);
     }
 
     /**
-     * @brief Get verbosity level for a section.
-     * @param section Section name.
-     * @return Section level if found; otherwise default level.
+     * @brief Get verbosity level for a section (a single array read).
+     * @param section Section id.
+     * @return Section level; 0 means the section is disabled.
      */
-    uint8_t getSectionLevel(const char *section) const
+    uint8_t getSectionLevel(DebugSection section) const
     {
-        int idx = findSectionIndex(section);
-        return (idx >= 0) ? _sectionLevels[idx] : _defaultLevel;
+        return _sectionLevels[section];
     }
 
     /**
-     * @brief Enable sections by comma-separated list (or 'all').
-     * @param csv Sections CSV; default is DEFAULT_SECTIONS.
+     * @brief Enable sections by comma-separated list (or 'all'); all other sections are disabled.
+     * @param csv Sections CSV; default is "all".
      */
-    void setSections(const char *csv = DEFAULT_SECTIONS)
+    void setSections(const char *csv = "all")
     {
         strncpy(_sectionsBuf, csv, sizeof(_sectionsBuf));
         _sectionsBuf[sizeof(_sectionsBuf) - 1] = '\0';
@@ -120,10 +189,10 @@ public:
 
     /**
      * @brief Print a debug message using default section level.
-     * @param section Section name.
+     * @param section Section id.
      * @param msg Null-terminated message.
      */
-    void print(const char *section, const char *msg) const
+    void print(DebugSection section, const char *msg) const
     {
         uint8_t lvl = getSectionLevel(section);
         print(section, lvl, msg);
@@ -131,17 +200,17 @@ public:
 
     /**
      * @brief Print a debug message if allowed by section and level.
-     * @param section Section name.
+     * @param section Section id.
      * @param level Verbosity level of this message.
      * @param msg Null-terminated message.
      */
-    void print(const char *section, uint8_t level, const char *msg) const
+    void print(DebugSection section, uint8_t level, const char *msg) const
     {
         uint8_t thresh = getSectionLevel(section);
         if (level > thresh)
             return;
         Serial.print("[");
-        Serial.print(section);
+        Serial.print(sectionName(section));
         Serial.print("] ");
         Serial.println(msg);
     }
@@ -149,29 +218,29 @@ public:
     /**
      * @brief Print any value if allowed by section and level.
      * @tparam T Any type supported by Serial.println.
-     * @param section Section name.
+     * @param section Section id.
      * @param level Verbosity level of this message.
      * @param value Value to print.
      */
     template <typename T>
-    void print(const char *section, uint8_t level, const T &value) const
+    void print(DebugSection section, uint8_t level, const T &value) const
     {
         uint8_t thresh = getSectionLevel(section);
         if (level > thresh)
             return;
         Serial.print("[");
-        Serial.print(section);
+        Serial.print(sectionName(section));
         Serial.print("] ");
         Serial.println(value);
     }
 
     /**
      * @brief Print a String message if allowed by section and level.
-     * @param section Section name.
+     * @param section Section id.
      * @param level Verbosity level of this message.
      * @param msg String message to print.
      */
-    void print(const char *section, uint8_t level, const String &msg) const
+    void print(DebugSection section, uint8_t level, const String &msg) const
     {
         print(section, level, msg.c_str());
     }
@@ -179,16 +248,87 @@ public:
     /**
      * @brief Print any value using default section level.
      * @tparam T Any type supported by Serial.println.
-     * @param section Section name.
+     * @param section Section id.
      * @param value Value to print.
      */
     template <typename T>
-    void print(const char *section, const T &value) const
+    void print(DebugSection section, const T &value) const
     {
         uint8_t lvl = getSectionLevel(section);
         print(section, lvl, value);
     }
 
+    /**
+     * @brief Check whether a message would be printed, before anything is formatted.
+     * @param section Section id.
+     * @param level Verbosity level of the message.
+     */
+    bool enabled(DebugSection section, uint8_t level) const
+    {
+        return level <= getSectionLevel(section);
+    }
+
+    /**
+     * @brief Format a message into the log ring buffer (used by DBG_LOG).
+     *
+     * The caller has already passed the level check. If the buffer is full the
+     * whole line is dropped and counted rather than blocking on Serial.
+     * @param section Section id.
+     * @param fmt printf-style format string.
+     */
+    void logf(DebugSection section, const char *fmt, ...) __attribute__((format(printf, 3, 4)))
+    {
+        char line[DEBUG_LOG_LINE_MAX];
+        int n = snprintf(line, sizeof(line), "[%s] ", sectionName(section));
+        if (n < 0)
+            return;
+        if (n > (int)sizeof(line) - 2)
+            n = sizeof(line) - 2;
+        va_list args;
+        va_start(args, fmt);
+        int m = vsnprintf(line + n, sizeof(line) - n - 1, fmt, args);
+        va_end(args);
+        if (m > 0)
+            n += (m < (int)sizeof(line) - n - 1) ? m : (int)sizeof(line) - n - 2;
+        line[n++] = '\n';
+        push(line, n);
+    }
+
+    /**
+     * @brief Write queued log output to Serial without blocking.
+     *
+     * Call once per loop() iteration, after the time-critical work. Writes at most
+     * what the Serial TX buffer can take right now, so nothing while it is full (or up to
+     * maxBytes if the core cannot report the free space and returns a negative value).
+     * @param maxBytes Upper bound on bytes written by this call.
+     */
+    void drain(uint16_t maxBytes = 64)
+    {
+        if (_logHead == _logTail)
+            return;
+        int room = Serial.availableForWrite();
+        if (room == 0)
+            return; // TX buffer full: try again next loop
+        uint16_t budget = (room > 0 && room < maxBytes) ? (uint16_t)room : maxBytes;
+        while (budget > 0 && _logHead != _logTail)
+        {
+            // Write the longest contiguous run before the buffer wraps
+            uint16_t run = (_logHead > _logTail) ? _logHead - _logTail : DEBUG_LOG_BUFFER_SIZE - _logTail;
+            if (run > budget)
+                run = budget;
+            Serial.write((const uint8_t *)&_logBuf[_logTail], run);
+            _logTail = (_logTail + run) % DEBUG_LOG_BUFFER_SIZE;
+            budget -= run;
+        }
+        if (_logDropped && _logHead == _logTail)
+        {
+            Serial.print("[Debugger] dropped ");
+            Serial.print(_logDropped);
+            Serial.println(" log lines (buffer full)");
+            _logDropped = 0;
+        }
+    }
+
     /**
      * @brief Print help menu of serial debug commands.
      */
@@ -283,10 +423,7 @@ public:
             }
             else
             {
-                if (arg.equalsIgnoreCase("all"))
-                    setSections(DEFAULT_SECTIONS);
-                else
-                    setSectionLevel(arg.c_str(), 0);
+                setSections(arg.c_str());
             }
             return true;
         }
@@ -302,74 +439,109 @@ public:
     void listSections() const
     {
         Serial.print("Available sections: ");
-        Serial.println(DEFAULT_SECTIONS);
+        for (uint8_t i = 0; i < DBG_SECTION_COUNT; ++i)
+        {
+            if (i)
+                Serial.print(",");
+            Serial.print(sectionName((DebugSection)i));
+        }
+        Serial.println();
     }
 
-    // List each enabled section and its current level
+    // List each section and its current level (0 = disabled)
     void listSectionLevels() const
     {
         Serial.println("Section levels:");
-        for (uint8_t i = 0; i < _numSections; ++i)
+        for (uint8_t i = 0; i < DBG_SECTION_COUNT; ++i)
         {
             Serial.print("  ");
-            Serial.print(_sections[i]);
+            Serial.print(sectionName((DebugSection)i));
             Serial.print(" = ");
             Serial.println(_sectionLevels[i]);
         }
     }
 
 private:
-    Debugger() : _initialized(false), _defaultLevel(2)
+    Debugger() : _initialized(false), _defaultLevel(2), _logHead(0), _logTail(0), _logDropped(0)
     {
-        strcpy(_sectionsBuf, DEFAULT_SECTIONS);
+        strcpy(_sectionsBuf, "all");
         parseSections(_sectionsBuf);
     }
-    ~Debugger()
+
+    // Case-insensitive name comparison, only used on the command path
+    static bool namesEqual(const char *a, const char *b)
     {
-        for (uint8_t i = 0; i < _numSections; ++i)
-            free((void *)_sections[i]);
+        while (*a && tolower((unsigned char)*a) == tolower((unsigned char)*b))
+            ++a, ++b;
+        return *a == '\0' && *b == '\0';
     }
 
-    // Split CSV into section names and init their levels
+    // Disable every section, then enable the ones named in the CSV at the default level
     void parseSections(const char *csv)
     {
-        _numSections = 0;
+        memset(_sectionLevels, 0, sizeof(_sectionLevels));
         char buf[64];
         strncpy(buf, csv, sizeof(buf));
         buf[sizeof(buf) - 1] = '\0';
-        char *tok = strtok(buf, ",");
-        while (tok && _numSections < MAX_SECTIONS)
+        char *tok = strtok(buf, ", ");
+        while (tok)
         {
-            strncpy(_sections[_numSections], tok, sizeof(_sections[_numSections]));
-            _sections[_numSections][sizeof(_sections[_numSections]) - 1] = '\0';
-            _sectionLevels[_numSections] = _defaultLevel;
-            ++_numSections;
-            tok = strtok(nullptr, ",");
+            if (namesEqual(tok, "all"))
+                memset(_sectionLevels, _defaultLevel, sizeof(_sectionLevels));
+            else
+            {
+                int idx = findSection(tok);
+                if (idx >= 0)
+                    _sectionLevels[idx] = _defaultLevel;
+            }
+            tok = strtok(nullptr, ", ");
         }
     }
 
-    // Find index of a section name or return -1
-    int findSectionIndex(const char *section) const
+    // Append a whole line to the ring buffer, or drop it if it does not fit
+    void push(const char *data, uint16_t len)
     {
-        for (uint8_t i = 0; i < _numSections; ++i)
+        uint16_t used = (_logHead + DEBUG_LOG_BUFFER_SIZE - _logTail) % DEBUG_LOG_BUFFER_SIZE;
+        if (len >= DEBUG_LOG_BUFFER_SIZE - used)
         {
-            if (strcmp(_sections[i], section) == 0)
-                return i;
+            ++_logDropped;
+            return;
+        }
+        for (uint16_t i = 0; i < len; ++i)
+        {
+            _logBuf[_logHead] = data[i];
+            _logHead = (_logHead + 1) % DEBUG_LOG_BUFFER_SIZE;
         }
-        return -1;
     }
 
     bool _initialized;
     uint8_t _defaultLevel;
     char _sectionsBuf[100];
-    char _sections[MAX_SECTIONS][20];
-    uint8_t _sectionLevels[MAX_SECTIONS];
-    uint8_t _numSections;
+    uint8_t _sectionLevels[DBG_SECTION_COUNT];
+    char _logBuf[DEBUG_LOG_BUFFER_SIZE];
+    uint16_t _logHead, _logTail;
+    uint32_t _logDropped;
 };
 
 /// Shortcut macro to access the Debugger singleton
 #define DBG Debugger::instance()
 
+/**
+ * @brief Log a printf-style message for a section at a level.
+ *
+ * Levels above DEBUG_MAX_LEVEL compile to nothing. Otherwise the arguments are
+ * only formatted once the section level check passes, and the result goes to
+ * the ring buffer drained by DBG.drain() instead of blocking on Serial.
+ *
+ *   DBG_LOG(DBG_ACCEL, 3, "X=%.3f Y=%.3f", x, y);
+ */
+#define DBG_LOG(section, level, fmt, ...)                                       \
+    do                                                                          \
+    {                                                                           \
+        if ((level) <= DEBUG_MAX_LEVEL && DBG.enabled((section), (level)))      \
+            DBG.logf((section), (fmt), ##__VA_ARGS__);                          \
+    } while (0)
+
 #endif // DEBUGGER_H
 
 // ==========================
@@ -386,19 +558,20 @@ private:
  *   Serial.println("Type 'DEBUG HELP' for commands");
  *   DBG.setDefaultLevel(3);
  *   DBG.setSections();
- *   DBG.setSectionLevel("Accel",1);
+ *   DBG.setSectionLevel(DBG_ACCEL, 1);
  *   DBG.listSections();
  *   DBG.listSectionLevels();
  * }
  *
  * void loop() {
  *   DBG.handleCommands();
- *   DBG.print("Accel", "Accel data (level 1)");
- *   DBG.print("Accel", 2, "Verbose accel (level 2)");
- *   DBG.print("LED_Control", 2, "LED update (level 2)");
- *   DBG.print("LED_Control", 4, "LED verbose (level 4)");
- *   DBG.print("Mode",2, sampleBuffer[i]);
- *   DBG.println("Microphone", "Mic reading ready");
+ *   DBG.print(DBG_ACCEL, "Accel data (level 1)");
+ *   DBG.print(DBG_ACCEL, 2, "Verbose accel (level 2)");
+ *   DBG.print(DBG_LED_CONTROL, 2, "LED update (level 2)");
+ *   DBG.print(DBG_LED_CONTROL, 4, "LED verbose (level 4)");
+ *   DBG.print(DBG_MICROPHONE, 2, sampleBuffer[i]);
+ *   DBG_LOG(DBG_ACCEL, 3, "x=%.3f", x);   // buffered, formatted only if enabled
+ *   DBG.drain();
  *   delay(1000);
  * }
  */
@@ -424,8 +597,8 @@ DEBUG Accel,LED_Control
 // 5. Set global default level to 1
 DBGLEVEL 1
 
-// 6. Disable 'Mode' section entirely
-DEBUG Mode 0
+// 6. Disable 'Temp' section entirely
+DEBUG Temp 0
 
 // 7. Enable all sections at level 4
 DEBUG all 4
@@ -0,0 +1,137 @@
+// File: EffectParams.h
+#ifndef EFFECT_PARAMS_H
+#define EFFECT_PARAMS_H
+
+#include <Arduino.h>
+#include <stddef.h>
+
+/**
+ * @file EffectParams.h
+ * @brief Typed, ranged, named effect parameters.
+ *
+ * Every effect publishes a schema: a constant table of ParamSpec entries naming the
+ * fields of its State it lets users change, with their type and range, plus the two
+ * segment fields most effects use (update interval and base color). Segment::setParam()
+ * validates a value against its spec and writes it in place, so a change takes effect on
+ * the next frame without restarting the effect or clearing its pixels.
+ *
+ * Values travel as int32: integers as they are, colors as 0xRRGGBB and FLOAT fields in
+ * thousandths (ripple speed 0.2 is 200). The same encoding is used by the binary batch
+ * frame (see PARAM_FRAME_SYNC), so tools and the text command share one code path.
+ */
+
+enum class ParamType : uint8_t
+{
+    U8,       ///< uint8_t field of the State
+    U16,      ///< uint16_t field of the State
+    FLOAT,    ///< float field of the State, set in thousandths
+    RGB,      ///< RgbColor field of the State, set as 0xRRGGBB
+    INTERVAL, ///< The segment's update interval in ms
+    COLOR     ///< The segment's base color, 0xRRGGBB
+};
+
+/// One parameter: name, type, where it lives in the State (for the State types) and range
+struct ParamSpec
+{
+    const char *name;
+    ParamType type;
+    uint8_t offset;
+    int32_t min;
+    int32_t max;
+};
+
+/// An effect's schema (a constant table in flash)
+struct ParamList
+{
+    ParamList() : specs(nullptr), count(0) {}
+    template <size_t N>
+    ParamList(const ParamSpec (&table)[N]) : specs(table), count(N) {}
+
+    const ParamSpec *specs;
+    uint8_t count;
+};
+
+/// Schema entry for a field of the effect's State
+#define PARAM_FIELD(StateType, field, label, type, lo, hi) \
+    {label, ParamType::type, offsetof(StateType, field), lo, hi}
+/// Schema entry for the segment's update interval (ms)
+#define PARAM_INTERVAL(lo, hi) {"interval", ParamType::INTERVAL, 0, lo, hi}
+/// Schema entry for the segment's base color
+#define PARAM_COLOR {"color", ParamType::COLOR, 0, 0, 0xFFFFFF}
+
+/// First byte of a binary parameter batch on the serial port. Frame layout:
+/// SYNC, segment, count, count x (param index, int32 value little-endian), XOR of every previous byte
+#define PARAM_FRAME_SYNC 0xA5
+/// Most records one frame may carry
+#define PARAM_FRAME_MAX 16
+/// Bytes per record in a frame
+#define PARAM_RECORD_BYTES 5
+
+namespace Params
+{
+    /// "u8", "u16", ... for listings
+    inline const char *typeName(ParamType t)
+    {
+        static const char *const names[] = {"u8", "u16", "float", "rgb", "ms", "color"};
+        return names[static_cast<uint8_t>(t)];
+    }
+
+    /// Case-insensitive name comparison (no String, so no allocation)
+    inline bool nameIs(const char *a, const char *b)
+    {
+        for (; *a && tolower(*a) == tolower(*b); ++a, ++b)
+        {
+        }
+        return *a == '\0' && *b == '\0';
+    }
+
+    inline bool isColor(ParamType t) { return t == ParamType::RGB || t == ParamType::COLOR; }
+
+    /**
+     * @brief Parse text into the int32 encoding of a spec: decimals for FLOAT ("0.25" -> 250),
+     *        hex for colors ("#FF8000", "0xFF8000", or decimal), integers otherwise.
+     * @return false if the text is not a number; the range is checked by setParam().
+     */
+    inline bool parse(const ParamSpec &spec, const char *text, int32_t &out)
+    {
+        bool hash = isColor(spec.type) && text[0] == '#';
+        const char *digits = hash ? text + 1 : text;
+        char *end = nullptr;
+        if (spec.type == ParamType::FLOAT)
+        {
+            double v = strtod(digits, &end);
+            out = (int32_t)(v * 1000.0 + (v < 0 ? -0.5 : 0.5));
+        }
+        else if (isColor(spec.type))
+        {
+            out = (int32_t)strtoul(digits, &end, hash ? 16 : 0);
+        }
+        else
+        {
+            out = (int32_t)strtol(digits, &end, 10);
+        }
+        return end != digits && *end == '\0';
+    }
+
+    /// Print a value in the notation parse() accepts
+    inline void print(Print &out, const ParamSpec &spec, int32_t value)
+    {
+        char text[16];
+        if (spec.type == ParamType::FLOAT)
+        {
+            snprintf(text, sizeof(text), "%s%ld.%03ld", value < 0 ? "-" : "", (long)(abs(value) / 1000),
+                     (long)(abs(value) % 1000));
+        }
+        else if (isColor(spec.type))
+        {
+            snprintf(text, sizeof(text), "#%06lX", (unsigned long)value);
+        }
+        else
+        {
+            snprintf(text, sizeof(text), "%ld", (long)value);
+        }
+        out.print(text);
+    }
+} // namespace Params
+
+#endif // EFFECT_PARAMS_H
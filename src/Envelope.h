@@ -0,0 +1,164 @@
+// File: Envelope.h
+#ifndef ENVELOPE_H
+#define ENVELOPE_H
+
+#include <Arduino.h>
+
+/**
+ * @file Envelope.h
+ * @brief Attack / hold / decay / sustain / release envelope generator.
+ *
+ * Turns an on/off gate, such as the audio trigger that fires once per FFT block, into a
+ * level that rises and falls over time. A gate that switches on (or comes back louder)
+ * starts the attack from the current level. The envelope holds at the peak, decays to
+ * the sustain level while the gate stays on, and releases to zero when the gate goes off.
+ * A trigger that flickers at block rate therefore gives one smooth swell.
+ *
+ * The level is kept in 8.16 fixed point and advanced once per frame by the elapsed
+ * milliseconds. The attack, decay and release times are for a full 0-255 swing.
+ */
+class Envelope
+{
+public:
+    enum Stage : uint8_t
+    {
+        IDLE,
+        ATTACK,
+        HOLD,
+        DECAY,
+        SUSTAIN,
+        RELEASE
+    };
+
+    uint16_t attackMs = 10;
+    uint16_t holdMs = 30;
+    uint16_t decayMs = 250;
+    uint8_t sustain = 96; ///< Level held while the gate stays on, relative to the peak (255 = the peak)
+    uint16_t releaseMs = 300;
+
+    /// Set all five settings at once
+    void configure(uint16_t attack, uint16_t hold, uint16_t decay, uint8_t sustainLevel, uint16_t release)
+    {
+        attackMs = attack;
+        holdMs = hold;
+        decayMs = decay;
+        sustain = sustainLevel;
+        releaseMs = release;
+    }
+
+    /**
+     * @brief Feed the gate. Switching on, or staying on with a higher velocity, (re)starts
+     *        the attack towards velocity; switching off starts the release.
+     */
+    void gate(bool on, uint8_t velocity)
+    {
+        uint32_t peak = (uint32_t)velocity << 16;
+        if (on && (!_gated || peak > _peak))
+        {
+            _peak = peak;
+            _stage = ATTACK;
+        }
+        else if (!on && _gated)
+        {
+            _stage = RELEASE;
+        }
+        _gated = on;
+    }
+
+    /// Advance by dt milliseconds; returns the new level (0-255)
+    uint8_t advance(uint32_t dt)
+    {
+        switch (_stage)
+        {
+        case ATTACK:
+        {
+            uint32_t rise = step(attackMs, dt);
+            if (_level >= _peak || _peak - _level <= rise)
+            {
+                _level = _peak;
+                _stage = HOLD;
+                _holdLeft = holdMs;
+            }
+            else
+            {
+                _level += rise;
+            }
+            break;
+        }
+        case HOLD:
+            if (dt < _holdLeft)
+            {
+                _holdLeft -= dt;
+                break;
+            }
+            _stage = DECAY;
+            break;
+        case DECAY:
+        {
+            uint32_t floor = sustainLevel();
+            uint32_t fall = step(decayMs, dt);
+            if (_level <= floor || _level - floor <= fall)
+            {
+                _level = floor;
+                _stage = SUSTAIN;
+            }
+            else
+            {
+                _level -= fall;
+            }
+            break;
+        }
+        case RELEASE:
+        {
+            uint32_t fall = step(releaseMs, dt);
+            if (_level <= fall)
+            {
+                _level = 0;
+                _stage = IDLE;
+            }
+            else
+            {
+                _level -= fall;
+            }
+            break;
+        }
+        default:
+            break;
+        }
+        return level();
+    }
+
+    uint8_t level() const { return _level >> 16; }
+    Stage stage() const { return _stage; }
+
+    static const char *stageName(uint8_t s)
+    {
+        static const char *const names[] = {"idle", "attack", "hold", "decay", "sustain", "release"};
+        return s <= RELEASE ? names[s] : "?";
+    }
+
+private:
+    static const uint32_t FULL = 255UL << 16;
+
+    // Change over dt ms of a segment that sweeps the full range in ms (0 = instantly)
+    static uint32_t step(uint16_t ms, uint32_t dt)
+    {
+        if (dt >= ms)
+            return FULL;
+        return FULL / ms * dt;
+    }
+
+    // Sustain level in 8.16 fixed point: the peak scaled by sustain (0-256)
+    uint32_t sustainLevel() const
+    {
+        return ((_peak >> 16) * (uint32_t)(sustain + (sustain >> 7))) << 8;
+    }
+
+    uint32_t _level = 0; // 8.16 fixed point
+    uint32_t _peak = 0;  // 8.16 fixed point
+    uint16_t _holdLeft = 0;
+    Stage _stage = IDLE;
+    bool _gated = false;
+};
+
+#endif // ENVELOPE_H
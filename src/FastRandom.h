@@ -0,0 +1,56 @@
+// File: FastRandom.h
+#ifndef FAST_RANDOM_H
+#define FAST_RANDOM_H
+
+#include <Arduino.h>
+
+/**
+ * @file FastRandom.h
+ * @brief Small seedable pseudo-random generator for per-pixel effect noise.
+ *
+ * Arduino's random(min, max) reduces its generator output with a modulo, i.e. a division
+ * per call, which the fire effects pay several times per pixel per frame. This is a
+ * 32-bit xorshift (three shifts and XORs per step) whose bounded helpers scale the top
+ * 16 bits by multiplication instead, so each draw is a 32x32-bit multiply and a shift
+ * (single-cycle on the RP2040's M0+ core) with no division.
+ *
+ * Each segment owns one, reseeded from the segment's seed whenever an effect starts, so
+ * the same seed and parameters replay the same frames.
+ */
+
+/**
+ * @class FastRandom
+ * @brief xorshift32 generator with division-free bounded draws.
+ */
+class FastRandom
+{
+public:
+    explicit FastRandom(uint32_t seed = 1) { this->seed(seed); }
+
+    /// Restart the sequence; any value is accepted (0 is replaced, xorshift never leaves it)
+    void seed(uint32_t s) { _state = s ? s : 0x6D2B79F5UL; }
+
+    /// Next 32 random bits
+    inline uint32_t next()
+    {
+        uint32_t x = _state;
+        x ^= x << 13;
+        x ^= x >> 17;
+        x ^= x << 5;
+        return _state = x;
+    }
+
+    /// Next 16 random bits (the high half, the better mixed one)
+    inline uint16_t next16() { return next() >> 16; }
+
+    /// Uniform in [0, n) (0 if n == 0); like random(n)
+    inline uint16_t below(uint16_t n) { return ((uint32_t)next16() * n) >> 16; }
+
+    /// Uniform in [lo, hi) (lo if hi <= lo); like random(lo, hi)
+    inline uint16_t range(uint16_t lo, uint16_t hi) { return hi > lo ? lo + below(hi - lo) : lo; }
+
+private:
+    uint32_t _state;
+};
+
+#endif // FAST_RANDOM_H
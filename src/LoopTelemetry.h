@@ -0,0 +1,212 @@
+// File: LoopTelemetry.h
+#ifndef LOOP_TELEMETRY_H
+#define LOOP_TELEMETRY_H
+
+#include <Arduino.h>
+#include "Profiler.h"
+
+/**
+ * @file LoopTelemetry.h
+ * @brief Main-loop health counters: loop rate, iteration-time percentiles, show() misses,
+ *        effective LED fps and idle headroom.
+ *
+ * loop() brackets each pass with beginIteration()/endIteration(), hands the result of
+ * PixelStrip::show() to noteShow() and calls noteWork() for anything else it did (a
+ * command, an audio block, a sensor sample, a rendered frame). Only passes that did none of
+ * that count as idle, since they just polled and waited: a high idle percentage means there
+ * is CPU to spare for more segments or LEDs, 0% means the loop never had to wait.
+ */
+
+/// Iteration-time histogram: 4 sub-buckets per power of two, covering 0 us .. ~2 s
+static const uint8_t TELEMETRY_BUCKETS = 80;
+
+/**
+ * @class LoopTelemetry
+ * @brief Windowed loop statistics, printed on request or every N seconds.
+ */
+class LoopTelemetry
+{
+public:
+    /**
+     * @brief Get the singleton instance.
+     * @return Reference to LoopTelemetry singleton.
+     */
+    static LoopTelemetry &instance()
+    {
+        static LoopTelemetry inst;
+        return inst;
+    }
+
+    /**
+     * @brief Mark the start of a loop() pass.
+     */
+    inline void beginIteration()
+    {
+        _iterStart = Profiler::now();
+        _worked = false;
+    }
+
+    /**
+     * @brief Record the outcome of PixelStrip::show() for this pass.
+     * @param sent true if a frame was pushed, false if CanShow() was false.
+     */
+    inline void noteShow(bool sent)
+    {
+        if (sent)
+            ++_shows;
+        else
+            ++_showMisses;
+        _worked |= sent;
+    }
+
+    /**
+     * @brief Mark this pass as busy: it did work other than sending a frame.
+     */
+    inline void noteWork() { _worked = true; }
+
+    /**
+     * @brief Mark the end of a loop() pass and print a report if the period has elapsed.
+     */
+    void endIteration()
+    {
+        uint32_t us = Profiler::now() - _iterStart;
+        ++_iterations;
+        ++_hist[bucketFor(us)];
+        if (us > _maxUs)
+            _maxUs = us;
+        if (_worked)
+            _busyUs += us;
+        else
+            _idleUs += us;
+
+        if (_periodMs && millis() - _windowStartMs >= _periodMs)
+        {
+            report(Serial);
+            reset();
+        }
+    }
+
+    /**
+     * @brief Clear the current window.
+     */
+    void reset()
+    {
+        memset(_hist, 0, sizeof(_hist));
+        _iterations = _shows = _showMisses = 0;
+        _maxUs = 0;
+        _busyUs = _idleUs = 0;
+        _windowStartMs = millis();
+    }
+
+    /**
+     * @brief Iteration time (us) below which the given percentage of passes fell.
+     * @param pct Percentile, 0-100.
+     * @return Upper edge of the histogram bucket holding that percentile.
+     */
+    uint32_t percentile(uint8_t pct) const
+    {
+        if (_iterations == 0)
+            return 0;
+        uint32_t target = (uint32_t)(((uint64_t)_iterations * pct + 99) / 100);
+        uint32_t seen = 0;
+        for (uint8_t i = 0; i < TELEMETRY_BUCKETS; ++i)
+        {
+            seen += _hist[i];
+            if (seen >= target)
+                return bucketUpper(i);
+        }
+        return _maxUs;
+    }
+
+    /**
+     * @brief Print one report line for the current window.
+     */
+    void report(Print &out) const
+    {
+        unsigned long windowMs = millis() - _windowStartMs;
+        if (windowMs == 0)
+            windowMs = 1;
+        uint64_t totalUs = _busyUs + _idleUs;
+        char line[160];
+        snprintf(line, sizeof(line),
+                 "Loop: %lu Hz | iter us p50 %lu p95 %lu p99 %lu max %lu | LED %lu.%lu fps, %lu show misses | idle %u%%",
+                 (unsigned long)((uint64_t)_iterations * 1000 / windowMs),
+                 (unsigned long)percentile(50), (unsigned long)percentile(95),
+                 (unsigned long)percentile(99), (unsigned long)_maxUs,
+                 (unsigned long)((uint64_t)_shows * 1000 / windowMs),
+                 (unsigned long)(((uint64_t)_shows * 10000 / windowMs) % 10),
+                 (unsigned long)_showMisses,
+                 (unsigned)(totalUs ? _idleUs * 100 / totalUs : 0));
+        out.println(line);
+    }
+
+    /**
+     * @brief Handle the parameters of a `telemetry` serial command.
+     * @param params "" prints now; "<seconds>" reports periodically (0 stops); "reset" clears.
+     */
+    void handleCommand(const String &params)
+    {
+        if (params.length() == 0)
+        {
+            report(Serial);
+        }
+        else if (params.equalsIgnoreCase("reset"))
+        {
+            reset();
+            Serial.println("Loop telemetry reset.");
+        }
+        else if (isdigit(params.charAt(0)))
+        {
+            _periodMs = (unsigned long)params.toInt() * 1000UL;
+            reset();
+            Serial.print("Loop telemetry period: ");
+            Serial.println(_periodMs ? String(_periodMs / 1000) + " s" : String("off"));
+        }
+        else
+        {
+            Serial.println("Invalid format. Use: telemetry [<seconds>|reset]");
+        }
+    }
+
+private:
+    LoopTelemetry() : _periodMs(0), _iterStart(0), _worked(false)
+    {
+        reset();
+    }
+
+    // 0-3 us map 1:1, above that each power of two is split into 4 buckets
+    static inline uint8_t bucketFor(uint32_t us)
+    {
+        if (us < 4)
+            return us;
+        uint8_t octave = 31 - __builtin_clz(us);
+        uint8_t idx = (octave - 1) * 4 + ((us >> (octave - 2)) & 3);
+        return idx < TELEMETRY_BUCKETS ? idx : TELEMETRY_BUCKETS - 1;
+    }
+
+    static inline uint32_t bucketUpper(uint8_t idx)
+    {
+        if (idx < 4)
+            return idx;
+        uint8_t octave = idx / 4 + 1;
+        uint32_t lower = (uint32_t)(4 + idx % 4) << (octave - 2);
+        return lower + (1UL << (octave - 2)) - 1;
+    }
+
+    unsigned long _periodMs;
+    unsigned long _windowStartMs;
+    uint32_t _iterStart;
+    bool _worked;
+    uint32_t _iterations;
+    uint32_t _shows;
+    uint32_t _showMisses;
+    uint32_t _maxUs;
+    uint64_t _busyUs;
+    uint64_t _idleUs;
+    uint32_t _hist[TELEMETRY_BUCKETS];
+};
+
+/// Shortcut macro to access the LoopTelemetry singleton
+#define TELEM LoopTelemetry::instance()
+
+#endif // LOOP_TELEMETRY_H
@@ -0,0 +1,223 @@
+/**
+ * @file MemoryReport.cpp
+ * @brief Platform-specific heap/stack measurement and the optional counting allocator.
+ */
+
+#include "MemoryReport.h"
+#include <malloc.h>
+#include <stddef.h>
+#include <new>
+
+#if defined(ARDUINO_ARCH_MBED)
+#include <mbed.h>
+#include <rtx_os.h>
+#endif
+
+// ——— HEAP ————————————————————————————————————————————————————
+
+static const uint8_t STACK_PAINT = 0xA5;
+static const uint32_t PROBE_CAP = 256UL * 1024UL; // Nothing larger can exist on a 264 KB part
+static const uint8_t PROBE_MAX_BLOCKS = 32;
+
+// Largest single malloc that succeeds right now (binary search, every probe freed)
+static uint32_t probeLargest(uint32_t cap)
+{
+    uint32_t lo = 0, hi = cap;
+    while (lo < hi)
+    {
+        uint32_t mid = lo + (hi - lo + 1) / 2;
+        void *p = malloc(mid);
+        if (p)
+        {
+            free(p);
+            lo = mid;
+        }
+        else
+        {
+            hi = mid - 1;
+        }
+    }
+    return lo;
+}
+
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 33))
+#define MALLINFO mallinfo2
+#else
+#define MALLINFO mallinfo
+#endif
+
+uint32_t MemoryReport::heapUsed()
+{
+    return MALLINFO().uordblks;
+}
+
+MemoryReport::HeapInfo MemoryReport::heapInfo()
+{
+    HeapInfo info = {};
+    struct MALLINFO mi = MALLINFO();
+    info.usedBytes = mi.uordblks;
+    info.arenaBytes = mi.arena;
+
+#ifdef ARDUINO
+    // Grab the largest block repeatedly until the heap is exhausted, threading the
+    // blocks into a list through their own first word, then release them all.
+    info.largestBlock = probeLargest(PROBE_CAP);
+    void *head = nullptr;
+    for (uint8_t i = 0; i < PROBE_MAX_BLOCKS; ++i)
+    {
+        uint32_t size = (i == 0) ? info.largestBlock : probeLargest(PROBE_CAP);
+        if (size < sizeof(void *))
+            break;
+        void *p = malloc(size);
+        if (!p)
+            break;
+        *(void **)p = head;
+        head = p;
+        info.freeBytes += size;
+    }
+    while (head)
+    {
+        void *next = *(void **)head;
+        free(head);
+        head = next;
+    }
+    if (info.freeBytes)
+        info.fragmentation = 100 - (uint8_t)((uint64_t)info.largestBlock * 100 / info.freeBytes);
+#endif
+    return info;
+}
+
+// ——— STACK ———————————————————————————————————————————————————
+
+#if defined(ARDUINO_ARCH_MBED)
+// RTX keeps a magic word at the bottom of every thread stack; never paint over it
+static const uint32_t STACK_GUARD = 16;
+// Room left for the frame of paintStack() itself and anything it calls
+static const uint32_t STACK_MARGIN = 256;
+
+__attribute__((noinline)) void MemoryReport::paintStack()
+{
+    osRtxThread_t *t = (osRtxThread_t *)osThreadGetId();
+    if (!t || !t->stack_mem)
+        return;
+    volatile uint8_t *lo = (volatile uint8_t *)t->stack_mem + STACK_GUARD;
+    volatile uint8_t *hi = (volatile uint8_t *)__builtin_frame_address(0) - STACK_MARGIN;
+    for (volatile uint8_t *p = lo; p < hi; ++p)
+        *p = STACK_PAINT;
+}
+
+uint32_t MemoryReport::stackHighWater(uint32_t &sizeBytes)
+{
+    osRtxThread_t *t = (osRtxThread_t *)osThreadGetId();
+    if (!t || !t->stack_mem)
+    {
+        sizeBytes = 0;
+        return 0;
+    }
+    sizeBytes = t->stack_size;
+    const uint8_t *base = (const uint8_t *)t->stack_mem;
+    const uint8_t *p = base + STACK_GUARD;
+    const uint8_t *end = base + t->stack_size;
+    while (p < end && *p == STACK_PAINT)
+        ++p;
+    return (uint32_t)(end - p);
+}
+#else
+void MemoryReport::paintStack() {}
+
+uint32_t MemoryReport::stackHighWater(uint32_t &sizeBytes)
+{
+    sizeBytes = 0;
+    return 0;
+}
+#endif
+
+// ——— COUNTING ALLOCATOR ——————————————————————————————————————
+
+static MemoryReport::AllocCounters s_counters = {};
+
+MemoryReport::AllocCounters MemoryReport::allocCounters()
+{
+    return s_counters;
+}
+
+#if MEMORY_TRACK_ALLOCS
+// Each block carries its size in a header so delete can account for it. The header is as
+// large as the strictest fundamental alignment, so the block after it keeps malloc's alignment.
+static const size_t ALLOC_HEADER = alignof(max_align_t) > sizeof(size_t) ? alignof(max_align_t) : sizeof(size_t);
+
+static void *countedAlloc(size_t size)
+{
+    uint8_t *p = (uint8_t *)malloc(size + ALLOC_HEADER);
+    if (!p)
+        return nullptr;
+    *(size_t *)p = size;
+    ++s_counters.allocs;
+    s_counters.liveBytes += size;
+    if (s_counters.liveBytes > s_counters.peakBytes)
+        s_counters.peakBytes = s_counters.liveBytes;
+    return p + ALLOC_HEADER;
+}
+
+static void countedFree(void *ptr)
+{
+    if (!ptr)
+        return;
+    uint8_t *p = (uint8_t *)ptr - ALLOC_HEADER;
+    ++s_counters.frees;
+    s_counters.liveBytes -= *(size_t *)p;
+    free(p);
+}
+
+void *operator new(size_t size) { return countedAlloc(size); }
+void *operator new[](size_t size) { return countedAlloc(size); }
+void *operator new(size_t size, const std::nothrow_t &) noexcept { return countedAlloc(size); }
+void *operator new[](size_t size, const std::nothrow_t &) noexcept { return countedAlloc(size); }
+void operator delete(void *ptr) noexcept { countedFree(ptr); }
+void operator delete[](void *ptr) noexcept { countedFree(ptr); }
+void operator delete(void *ptr, size_t) noexcept { countedFree(ptr); }
+void operator delete[](void *ptr, size_t) noexcept { countedFree(ptr); }
+#endif
+
+// ——— REPORT ——————————————————————————————————————————————————
+
+void MemoryReport::printFootprint(Print &out, const char *name, uint32_t bytes)
+{
+    char line[64];
+    snprintf(line, sizeof(line), "  %-26s %7lu B", name, (unsigned long)bytes);
+    out.println(line);
+}
+
+void MemoryReport::printRuntime(Print &out)
+{
+    char line[96];
+    HeapInfo h = heapInfo();
+    out.println("Heap:");
+    snprintf(line, sizeof(line), "  used %lu B, arena %lu B", (unsigned long)h.usedBytes,
+             (unsigned long)h.arenaBytes);
+    out.println(line);
+#ifdef ARDUINO
+    snprintf(line, sizeof(line), "  free %lu B, largest block %lu B, fragmentation %u%%",
+             (unsigned long)h.freeBytes, (unsigned long)h.largestBlock, h.fragmentation);
+    out.println(line);
+#endif
+
+#if MEMORY_TRACK_ALLOCS
+    AllocCounters c = allocCounters();
+    snprintf(line, sizeof(line), "  new/delete: %lu allocs, %lu frees, live %lu B, peak %lu B",
+             (unsigned long)c.allocs, (unsigned long)c.frees, (unsigned long)c.liveBytes,
+             (unsigned long)c.peakBytes);
+    out.println(line);
+#endif
+
+    uint32_t stackSize = 0;
+    uint32_t stackUsed = stackHighWater(stackSize);
+    out.println("Stack high-water:");
+    if (stackSize)
+        snprintf(line, sizeof(line), "  core0 (loop): %lu of %lu B", (unsigned long)stackUsed,
+                 (unsigned long)stackSize);
+    else
+        snprintf(line, sizeof(line), "  core0 (loop): n/a on this platform");
+    out.println(line);
+    out.println("  core1: not used by this sketch");
+}
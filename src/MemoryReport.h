@@ -0,0 +1,90 @@
+#ifndef MEMORY_REPORT_H
+#define MEMORY_REPORT_H
+
+#include <Arduino.h>
+
+/**
+ * @file MemoryReport.h
+ * @brief Heap, stack and static-footprint accounting for the `mem` serial command.
+ *
+ * Heap figures come from mallinfo() plus a malloc probe for the largest free block.
+ * Stack high-water is measured by painting the unused part of the loop() thread's
+ * stack in setup() and scanning for the first overwritten byte.
+ *
+ * With MEMORY_TRACK_ALLOCS=1 (the default on host builds, and the
+ * nanorp2040connect_debug environment on the device) the global operator
+ * new/delete are replaced by a counting allocator so soak tests can assert that a
+ * code path performs no allocations.
+ */
+
+#ifndef MEMORY_TRACK_ALLOCS
+#ifdef ARDUINO
+#define MEMORY_TRACK_ALLOCS 0
+#else
+#define MEMORY_TRACK_ALLOCS 1
+#endif
+#endif
+
+/**
+ * @class MemoryReport
+ * @brief Static helpers that measure and print memory usage.
+ */
+class MemoryReport
+{
+public:
+    struct HeapInfo
+    {
+        uint32_t usedBytes;     ///< Bytes currently allocated by malloc/new
+        uint32_t arenaBytes;    ///< Bytes the heap has claimed from the system so far (its size, not peak use)
+        uint32_t freeBytes;     ///< Total bytes that could still be allocated (probed)
+        uint32_t largestBlock;  ///< Largest single allocation that would succeed right now
+        uint8_t fragmentation;  ///< 100 - largestBlock * 100 / freeBytes
+    };
+
+    struct AllocCounters
+    {
+        uint32_t allocs;    ///< operator new calls since boot
+        uint32_t frees;     ///< operator delete calls since boot
+        uint32_t liveBytes; ///< Bytes currently held through operator new
+        uint32_t peakBytes; ///< Highest liveBytes seen
+    };
+
+    /**
+     * @brief Fill unused stack below the caller with a known pattern. Call first thing in setup().
+     */
+    static void paintStack();
+
+    /**
+     * @brief Bytes currently allocated from the heap (cheap; no probing).
+     */
+    static uint32_t heapUsed();
+
+    /**
+     * @brief Measure the heap. Briefly allocates and frees blocks to probe free space.
+     */
+    static HeapInfo heapInfo();
+
+    /**
+     * @brief Deepest stack use of the loop() thread since paintStack(), in bytes.
+     * @param[out] sizeBytes Total stack size of that thread (0 if unknown).
+     * @return High-water mark in bytes, or 0 if it cannot be measured on this platform.
+     */
+    static uint32_t stackHighWater(uint32_t &sizeBytes);
+
+    /**
+     * @brief Counters from the instrumented operator new/delete (all zero if MEMORY_TRACK_ALLOCS is 0).
+     */
+    static AllocCounters allocCounters();
+
+    /**
+     * @brief Print heap, allocator and stack sections of the report.
+     */
+    static void printRuntime(Print &out);
+
+    /**
+     * @brief Print one "name: bytes" line of the static footprint table.
+     */
+    static void printFootprint(Print &out, const char *name, uint32_t bytes);
+};
+
+#endif // MEMORY_REPORT_H
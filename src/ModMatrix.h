@@ -0,0 +1,532 @@
+// File: ModMatrix.h
+#ifndef MOD_MATRIX_H
+#define MOD_MATRIX_H
+
+#include <Arduino.h>
+#include "PixelStrip.h"
+#include "Noise.h"
+#include "Envelope.h"
+
+/**
+ * @file ModMatrix.h
+ * @brief Modulation matrix: routes audio, motion, LFO and envelope sources to effect
+ *        parameters and segment brightness.
+ *
+ * Sources are normalized to one byte each and kept in a flat array. The audio and IMU
+ * code push new readings when they have them; evaluate() runs once per main-loop pass,
+ * advances the LFOs and impact decay, then walks the route table: each route writes
+ * offset + depth * level / 255 into one parameter of one segment (see EffectParams.h),
+ * clamped to the parameter's range. Each route costs a multiply and a shift, and effects
+ * need no changes: they read their State as usual. level() exposes the sources to effects
+ * that want to react to them directly.
+ *
+ * Routes name a segment, a parameter of the effect running there and a source; one is
+ * skipped while its segment runs a different effect than the one it was made for. A route
+ * to "brightness" instead sets the segment's gain (see Segment::setGain()), whatever effect
+ * it runs.
+ *
+ * The envelopes (see Envelope.h) are gated by the audio trigger through gate() and advanced
+ * by evaluate(), so effects and routes see them swell and fade instead of flickering at the
+ * FFT block rate.
+ */
+
+/// Most routes at once
+#ifndef MOD_MAX_ROUTES
+#define MOD_MAX_ROUTES 16
+#endif
+/// Time for an impact to decay from full strength to zero, in ms
+#ifndef MOD_IMPACT_DECAY_MS
+#define MOD_IMPACT_DECAY_MS 500
+#endif
+
+/// Modulation sources, each 0-255. Format: X(ENUM_NAME, "command name")
+#define MOD_SOURCE_LIST(X) \
+    X(BASS, "bass")        \
+    X(MID, "mid")          \
+    X(TREBLE, "treble")    \
+    X(BEAT, "beat")        \
+    X(ACCEL_X, "accelx")   \
+    X(ACCEL_Y, "accely")   \
+    X(ACCEL_Z, "accelz")   \
+    X(IMPACT, "impact")    \
+    X(LFO1, "lfo1")        \
+    X(LFO2, "lfo2")        \
+    X(ENV1, "env1")        \
+    X(ENV2, "env2")
+
+/**
+ * @class ModMatrix
+ * @brief Source levels, LFOs and the route table.
+ */
+class ModMatrix
+{
+public:
+    enum Source : uint8_t
+    {
+#define MOD_SOURCE_ENUM(name, label) name,
+        MOD_SOURCE_LIST(MOD_SOURCE_ENUM)
+#undef MOD_SOURCE_ENUM
+            SOURCE_COUNT
+    };
+
+    enum LfoShape : uint8_t
+    {
+        SINE,
+        TRIANGLE,
+        SAW,
+        SQUARE
+    };
+
+    static const uint8_t LFOS = 2;
+    static const uint8_t ENVELOPES = 2;
+    enum : uint8_t
+    {
+        BRIGHTNESS = 0xFF, ///< Route param for the segment's brightness (gain) rather than an effect parameter
+        ANY_EFFECT = 0xFF  ///< Route effect of a brightness route: applies whatever the segment runs
+    };
+
+    struct Route
+    {
+        uint8_t source;
+        uint8_t segment;
+        uint8_t param;
+        uint8_t effect; // SegmentEffect the param index belongs to, or ANY_EFFECT
+        int32_t depth;  // Added at full level, in the param's units
+        int32_t offset; // Value at level 0
+    };
+
+    /**
+     * @brief Access the singleton instance.
+     * @return Reference to the ModMatrix singleton.
+     */
+    static ModMatrix &instance()
+    {
+        static ModMatrix inst;
+        return inst;
+    }
+
+    /// New audio analysis: band levels (0-255) and whether the bass is over the beat threshold
+    void setAudio(uint8_t bass, uint8_t mid, uint8_t treble, bool beat)
+    {
+        _levels[BASS] = bass;
+        _levels[MID] = mid;
+        _levels[TREBLE] = treble;
+        _levels[BEAT] = beat ? 255 : 0;
+    }
+
+    /**
+     * @brief New accelerometer reading in g. Each axis maps -2..+2 g to 0..255 (128 = level);
+     *        the impact source jumps to the reading's distance from 1 g (2 g = 255) and decays.
+     */
+    void setMotion(float x, float y, float z)
+    {
+        _levels[ACCEL_X] = axisLevel(x);
+        _levels[ACCEL_Y] = axisLevel(y);
+        _levels[ACCEL_Z] = axisLevel(z);
+        float jolt = fabsf(sqrtf(x * x + y * y + z * z) - 1.0f) * 128.0f;
+        uint16_t strength = jolt > 255.0f ? 255 * 256 : (uint16_t)(jolt * 256.0f);
+        if (strength > _impact)
+        {
+            _impact = strength;
+        }
+    }
+
+    /// Audio trigger state: gates every envelope, velocity being the trigger's brightness
+    void gate(bool isActive, uint8_t velocity)
+    {
+        for (uint8_t i = 0; i < ENVELOPES; ++i)
+        {
+            _envelopes[i].gate(isActive, velocity);
+        }
+    }
+
+    /// Envelope i, for its settings
+    Envelope &envelope(uint8_t i) { return _envelopes[i < ENVELOPES ? i : 0]; }
+
+    /// Current level of a source (0-255)
+    inline uint8_t level(Source s) const { return _levels[s]; }
+
+    /// Period (ms, 0 = stopped) and shape of LFO i
+    void setLfo(uint8_t i, uint16_t periodMs, LfoShape shape)
+    {
+        if (i < LFOS)
+        {
+            _lfoPeriod[i] = periodMs;
+            _lfoShape[i] = shape;
+        }
+    }
+
+    /**
+     * @brief Advance the time-based sources (LFOs, envelopes, impact decay) and apply every
+     *        route. Call once per frame, before PixelStrip::update().
+     */
+    void evaluate(PixelStrip &strip, unsigned long now)
+    {
+        uint32_t dt = now - _lastEvaluate;
+        _lastEvaluate = now;
+        uint32_t decay = dt * (255 * 256 / MOD_IMPACT_DECAY_MS);
+        _impact = decay >= _impact ? 0 : _impact - decay;
+        _levels[IMPACT] = _impact >> 8;
+        for (uint8_t i = 0; i < LFOS; ++i)
+        {
+            _levels[LFO1 + i] = lfoLevel(i, now);
+        }
+        for (uint8_t i = 0; i < ENVELOPES; ++i)
+        {
+            _levels[ENV1 + i] = _envelopes[i].advance(dt);
+        }
+
+        PixelStrip::SegmentList segments = strip.getSegments();
+        for (uint8_t r = 0; r < _routeCount; ++r)
+        {
+            const Route &route = _routes[r];
+            if (route.segment >= segments.size())
+                continue;
+            PixelStrip::Segment *s = segments[route.segment];
+            if (!applies(route, s))
+                continue;
+            uint16_t scale = _levels[route.source] + (_levels[route.source] >> 7); // 0-256
+            int32_t value = route.offset + ((route.depth * (int32_t)scale) >> 8);
+            if (route.param == BRIGHTNESS)
+            {
+                s->setGain(value < 0 ? 0 : value > 255 ? 255 : value);
+            }
+            else
+            {
+                s->modulateParam(route.param, value);
+            }
+        }
+    }
+
+    /**
+     * @brief Route a source to a parameter of the effect running on a segment, or to its
+     *        brightness if param is BRIGHTNESS.
+     * @return false if the table is full, the segment has no such parameter or it is a color.
+     */
+    bool addRoute(PixelStrip::Segment *target, uint8_t param, Source source, int32_t depth, int32_t offset)
+    {
+        ParamList list = target->params();
+        bool brightness = param == BRIGHTNESS;
+        if (_routeCount >= MOD_MAX_ROUTES || (!brightness && param >= list.count) ||
+            (!brightness && Params::isColor(list.specs[param].type)) || source >= SOURCE_COUNT ||
+            depth > MAX_DEPTH || depth < -MAX_DEPTH)
+        {
+            return false;
+        }
+        Route &route = _routes[_routeCount++];
+        route.source = source;
+        route.segment = target->getId();
+        route.param = param;
+        route.effect = brightness ? static_cast<uint8_t>(ANY_EFFECT) : static_cast<uint8_t>(target->activeEffect);
+        route.depth = depth;
+        route.offset = offset;
+        if (!brightness)
+        {
+            target->paramsChanged(); // Its frames no longer match a twin's
+        }
+        return true;
+    }
+
+    /// Remove route i; a brightness route leaves its segment at full gain
+    bool removeRoute(uint8_t i, PixelStrip &strip)
+    {
+        if (i >= _routeCount)
+            return false;
+        release(_routes[i], strip);
+        memmove(&_routes[i], &_routes[i + 1], (_routeCount - i - 1) * sizeof(Route));
+        --_routeCount;
+        return true;
+    }
+
+    void clearRoutes(PixelStrip &strip)
+    {
+        for (uint8_t r = 0; r < _routeCount; ++r)
+        {
+            release(_routes[r], strip);
+        }
+        _routeCount = 0;
+    }
+
+    /// Drop the routes to segment firstId and up once those segments are removed, so they
+    /// don't drive the segments that later take the same ids
+    void dropSegmentRoutes(uint8_t firstId)
+    {
+        uint8_t kept = 0;
+        for (uint8_t r = 0; r < _routeCount; ++r)
+        {
+            if (_routes[r].segment < firstId)
+            {
+                _routes[kept++] = _routes[r];
+            }
+        }
+        _routeCount = kept;
+    }
+
+    uint8_t routeCount() const { return _routeCount; }
+
+    static const char *sourceName(uint8_t s)
+    {
+        static const char *const names[] = {
+#define MOD_SOURCE_NAME(name, label) label,
+            MOD_SOURCE_LIST(MOD_SOURCE_NAME)
+#undef MOD_SOURCE_NAME
+        };
+        return s < SOURCE_COUNT ? names[s] : "?";
+    }
+
+    static const char *shapeName(uint8_t shape)
+    {
+        static const char *const names[] = {"sine", "triangle", "saw", "square"};
+        return shape <= SQUARE ? names[shape] : "?";
+    }
+
+    /// Schema of a brightness route's values: the segment's gain
+    static const ParamSpec &brightnessSpec()
+    {
+        static const ParamSpec spec = {"brightness", ParamType::U8, 0, 0, 255};
+        return spec;
+    }
+
+    /// Source levels, LFO and envelope settings and routes
+    void report(Print &out, PixelStrip &strip) const
+    {
+        char line[112];
+        out.print("Sources:");
+        for (uint8_t s = 0; s < SOURCE_COUNT; ++s)
+        {
+            snprintf(line, sizeof(line), " %s=%u", sourceName(s), (unsigned)_levels[s]);
+            out.print(line);
+        }
+        out.println();
+        for (uint8_t i = 0; i < LFOS; ++i)
+        {
+            snprintf(line, sizeof(line), "LFO %u: %u ms %s", (unsigned)(i + 1), (unsigned)_lfoPeriod[i],
+                     shapeName(_lfoShape[i]));
+            out.println(line);
+        }
+        for (uint8_t i = 0; i < ENVELOPES; ++i)
+        {
+            const Envelope &env = _envelopes[i];
+            snprintf(line, sizeof(line), "Envelope %u: attack %u ms, hold %u ms, decay %u ms, sustain %u, release %u ms (%s)",
+                     (unsigned)(i + 1), (unsigned)env.attackMs, (unsigned)env.holdMs, (unsigned)env.decayMs,
+                     (unsigned)env.sustain, (unsigned)env.releaseMs, Envelope::stageName(env.stage()));
+            out.println(line);
+        }
+        PixelStrip::SegmentList segments = strip.getSegments();
+        for (uint8_t r = 0; r < _routeCount; ++r)
+        {
+            const Route &route = _routes[r];
+            PixelStrip::Segment *s = route.segment < segments.size() ? segments[route.segment] : nullptr;
+            const ParamSpec *spec = nullptr;
+            if (route.param == BRIGHTNESS)
+            {
+                spec = &brightnessSpec();
+            }
+            else if (applies(route, s))
+            {
+                spec = &s->params().specs[route.param];
+            }
+            snprintf(line, sizeof(line), "Route %u: %s -> segment %u %s, depth ", (unsigned)r, sourceName(route.source),
+                     (unsigned)route.segment, spec ? spec->name : "(effect stopped or changed)");
+            out.print(line);
+            if (spec)
+            {
+                Params::print(out, *spec, route.depth);
+                out.print(", offset ");
+                Params::print(out, *spec, route.offset);
+            }
+            else
+            {
+                out.print(route.depth);
+                out.print(", offset ");
+                out.print(route.offset);
+            }
+            out.println();
+        }
+        if (_routeCount == 0)
+        {
+            out.println("No routes.");
+        }
+    }
+
+    /**
+     * @brief Handle the parameters of a `mod` serial command.
+     * @param params "" reports; "add <source> <segment> <param|brightness> <depth> [offset]"
+     *               routes a source (offset defaults to the current value); "del <n>",
+     *               "clear"; "lfo <1|2> <period ms> [sine|triangle|saw|square]";
+     *               "env <1|2> <attack> [hold] [decay] [sustain] [release]".
+     */
+    void handleCommand(const String &params, PixelStrip &strip)
+    {
+        char verb[8] = "", a[16] = "", b[16] = "", c[16] = "", d[24] = "", e[24] = "", f[8] = "";
+        int n = sscanf(params.c_str(), "%7s %15s %15s %15s %23s %23s %7s", verb, a, b, c, d, e, f);
+        if (n <= 0)
+        {
+            report(Serial, strip);
+        }
+        else if (strcmp(verb, "add") == 0 && n >= 5)
+        {
+            uint8_t source = findSource(a);
+            unsigned id = strtoul(b, nullptr, 10);
+            PixelStrip::SegmentList segments = strip.getSegments();
+            PixelStrip::Segment *target = id < segments.size() ? segments[id] : nullptr;
+            bool brightness = Params::nameIs(c, brightnessSpec().name);
+            int param = -1;
+            if (target)
+            {
+                param = brightness ? static_cast<int>(BRIGHTNESS) : target->findParam(c);
+            }
+            int32_t depth = 0, offset = 0;
+            if (source >= SOURCE_COUNT || param < 0)
+            {
+                Serial.println("Error: unknown source, segment or parameter (see 'mod' and 'params').");
+                return;
+            }
+            const ParamSpec &spec = brightness ? brightnessSpec() : target->params().specs[param];
+            offset = brightness ? target->getGain() : target->getParam(param);
+            if (!Params::parse(spec, d, depth) || (n >= 6 && !Params::parse(spec, e, offset)) ||
+                !addRoute(target, param, (Source)source, depth, offset))
+            {
+                Serial.println("Error: route not added (table full, color parameter or bad depth/offset).");
+                return;
+            }
+            report(Serial, strip);
+        }
+        else if (strcmp(verb, "del") == 0 && n >= 2)
+        {
+            if (!removeRoute(atoi(a), strip))
+            {
+                Serial.println("Error: no such route.");
+                return;
+            }
+            report(Serial, strip);
+        }
+        else if (strcmp(verb, "clear") == 0)
+        {
+            clearRoutes(strip);
+            Serial.println("All routes removed.");
+        }
+        else if (strcmp(verb, "lfo") == 0 && n >= 3)
+        {
+            uint8_t shape = SINE;
+            while (n >= 4 && shape <= SQUARE && strcmp(c, shapeName(shape)) != 0)
+            {
+                ++shape;
+            }
+            int i = atoi(a) - 1;
+            if (i < 0 || i >= LFOS || shape > SQUARE)
+            {
+                Serial.println("Error: use mod lfo <1|2> <period ms> [sine|triangle|saw|square]");
+                return;
+            }
+            setLfo(i, constrain(atol(b), 0, 65535), (LfoShape)shape);
+            report(Serial, strip);
+        }
+        else if (strcmp(verb, "env") == 0 && n >= 3)
+        {
+            int i = atoi(a) - 1;
+            if (i < 0 || i >= ENVELOPES)
+            {
+                Serial.println("Error: use mod env <1|2> <attack> [hold] [decay] [sustain] [release]");
+                return;
+            }
+            // Settings not given keep their values
+            Envelope &env = _envelopes[i];
+            const char *values[] = {b, c, d, e, f};
+            uint16_t ms[] = {env.attackMs, env.holdMs, env.decayMs, env.sustain, env.releaseMs};
+            for (uint8_t k = 0; k + 2 < n && k < 5; ++k)
+            {
+                ms[k] = constrain(atol(values[k]), 0, k == 3 ? 255 : 65535);
+            }
+            env.configure(ms[0], ms[1], ms[2], ms[3], ms[4]);
+            report(Serial, strip);
+        }
+        else
+        {
+            Serial.println("Invalid format. Use: mod [add <source> <segment> <param> <depth> [offset] | del <n> | clear | lfo <n> <ms> [shape] | env <n> <attack> [hold] [decay] [sustain] [release]]");
+        }
+    }
+
+private:
+    ModMatrix() : _impact(0), _lastEvaluate(0), _routeCount(0)
+    {
+        memset(_levels, 0, sizeof(_levels));
+        _levels[ACCEL_X] = _levels[ACCEL_Y] = _levels[ACCEL_Z] = 128;
+        for (uint8_t i = 0; i < LFOS; ++i)
+        {
+            _lfoPeriod[i] = 2000 * (i + 1);
+            _lfoShape[i] = SINE;
+        }
+    }
+    ModMatrix(const ModMatrix &) = delete;
+    ModMatrix &operator=(const ModMatrix &) = delete;
+
+    static const int32_t MAX_DEPTH = 1L << 23; // depth * 256 stays within int32
+
+    // True if the route acts on s now: the segment runs and, for a parameter route, runs
+    // the effect the route was made for
+    static bool applies(const Route &route, const PixelStrip::Segment *s)
+    {
+        return s && s->active && (route.effect == ANY_EFFECT || static_cast<uint8_t>(s->activeEffect) == route.effect);
+    }
+
+    // Undo what a route leaves behind when it is removed
+    static void release(const Route &route, PixelStrip &strip)
+    {
+        PixelStrip::SegmentList segments = strip.getSegments();
+        if (route.param == BRIGHTNESS && route.segment < segments.size())
+        {
+            segments[route.segment]->setGain(255);
+        }
+    }
+
+    static uint8_t axisLevel(float g)
+    {
+        float v = (g + 2.0f) * 64.0f;
+        return v <= 0.0f ? 0 : v >= 255.0f ? 255 : (uint8_t)v;
+    }
+
+    static uint8_t findSource(const char *name)
+    {
+        uint8_t s = 0;
+        while (s < SOURCE_COUNT && strcmp(name, sourceName(s)) != 0)
+        {
+            ++s;
+        }
+        return s;
+    }
+
+    // Level of LFO i at time now: one 16-bit phase turn per period
+    uint8_t lfoLevel(uint8_t i, unsigned long now) const
+    {
+        if (_lfoPeriod[i] == 0)
+            return 0;
+        uint16_t phase = (uint16_t)(((now % _lfoPeriod[i]) << 16) / _lfoPeriod[i]);
+        uint8_t tri = (phase & 0x8000) ? ~(uint8_t)(phase >> 7) : (uint8_t)(phase >> 7);
+        switch (_lfoShape[i])
+        {
+        case TRIANGLE:
+            return tri;
+        case SAW:
+            return phase >> 8;
+        case SQUARE:
+            return (phase & 0x8000) ? 0 : 255;
+        default:
+            return Noise::smooth()[tri]; // Eased triangle: within a few percent of a raised cosine
+        }
+    }
+
+    uint8_t _levels[SOURCE_COUNT];
+    uint16_t _impact; // IMPACT level in 8.8 fixed point
+    unsigned long _lastEvaluate;
+    uint16_t _lfoPeriod[LFOS];
+    LfoShape _lfoShape[LFOS];
+    Envelope _envelopes[ENVELOPES];
+    Route _routes[MOD_MAX_ROUTES];
+    uint8_t _routeCount;
+};
+
+/// Shortcut macro to access the ModMatrix singleton
+#define MODS ModMatrix::instance()
+
+#endif // MOD_MATRIX_H
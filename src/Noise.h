@@ -0,0 +1,123 @@
+// File: Noise.h
+#ifndef NOISE_H
+#define NOISE_H
+
+#include <Arduino.h>
+
+/**
+ * @file Noise.h
+ * @brief Fixed-point value noise in one, two and three dimensions, for organic effects.
+ *
+ * Coordinates are 16-bit 8.8 fixed point: the high byte picks a lattice cell and the low
+ * byte is the position inside it. Every lattice point gets a pseudo-random byte from
+ * Ken Perlin's permutation table, and the noise is the interpolation between the
+ * surrounding points, eased by a smoothstep lookup table so cells join without creases.
+ * Everything is byte lookups, 8-bit lerps and shifts, with no floats and no division.
+ * The lattice repeats every 256 cells, so coordinates may wrap freely (e.g. a time axis).
+ *
+ * Typical cost per sample: 2/4/8 lattice lookups and 1/3/7 lerps for 1D/2D/3D.
+ */
+namespace Noise
+{
+    /// Permutation of 0..255 (Perlin's reference table)
+    inline const uint8_t *perm()
+    {
+        static const uint8_t table[256] = {
+            151, 160, 137,  91,  90,  15, 131,  13, 201,  95,  96,  53, 194, 233,   7, 225,
+            140,  36, 103,  30,  69, 142,   8,  99,  37, 240,  21,  10,  23, 190,   6, 148,
+            247, 120, 234,  75,   0,  26, 197,  62,  94, 252, 219, 203, 117,  35,  11,  32,
+             57, 177,  33,  88, 237, 149,  56,  87, 174,  20, 125, 136, 171, 168,  68, 175,
+             74, 165,  71, 134, 139,  48,  27, 166,  77, 146, 158, 231,  83, 111, 229, 122,
+             60, 211, 133, 230, 220, 105,  92,  41,  55,  46, 245,  40, 244, 102, 143,  54,
+             65,  25,  63, 161,   1, 216,  80,  73, 209,  76, 132, 187, 208,  89,  18, 169,
+            200, 196, 135, 130, 116, 188, 159,  86, 164, 100, 109, 198, 173, 186,   3,  64,
+             52, 217, 226, 250, 124, 123,   5, 202,  38, 147, 118, 126, 255,  82,  85, 212,
+            207, 206,  59, 227,  47,  16,  58,  17, 182, 189,  28,  42, 223, 183, 170, 213,
+            119, 248, 152,   2,  44, 154, 163,  70, 221, 153, 101, 155, 167,  43, 172,   9,
+            129,  22,  39, 253,  19,  98, 108, 110,  79, 113, 224, 232, 178, 185, 112, 104,
+            218, 246,  97, 228, 251,  34, 242, 193, 238, 210, 144,  12, 191, 179, 162, 241,
+             81,  51, 145, 235, 249,  14, 239, 107,  49, 192, 214,  31, 181, 199, 106, 157,
+            184,  84, 204, 176, 115, 121,  50,  45, 127,   4, 150, 254, 138, 236, 205,  93,
+            222, 114,  67,  29,  24,  72, 243, 141, 128, 195,  78,  66, 215,  61, 156, 180,
+        };
+        return table;
+    }
+
+    /// 256 * smoothstep(f / 256) for a cell fraction f, capped at 255
+    inline const uint8_t *smooth()
+    {
+        static const uint8_t table[256] = {
+              0,   0,   0,   0,   0,   0,   0,   1,   1,   1,   1,   1,   2,   2,   2,   3,
+              3,   3,   4,   4,   4,   5,   5,   6,   6,   7,   7,   8,   9,   9,  10,  10,
+             11,  12,  12,  13,  14,  14,  15,  16,  17,  18,  18,  19,  20,  21,  22,  23,
+             24,  25,  25,  26,  27,  28,  29,  30,  31,  32,  33,  35,  36,  37,  38,  39,
+             40,  41,  42,  43,  45,  46,  47,  48,  49,  51,  52,  53,  54,  56,  57,  58,
+             59,  61,  62,  63,  65,  66,  67,  69,  70,  71,  73,  74,  75,  77,  78,  80,
+             81,  82,  84,  85,  87,  88,  90,  91,  92,  94,  95,  97,  98, 100, 101, 103,
+            104, 106, 107, 109, 110, 112, 113, 115, 116, 118, 119, 121, 122, 124, 125, 127,
+            128, 129, 131, 132, 134, 135, 137, 138, 140, 141, 143, 144, 146, 147, 149, 150,
+            152, 153, 155, 156, 158, 159, 161, 162, 164, 165, 166, 168, 169, 171, 172, 174,
+            175, 176, 178, 179, 181, 182, 183, 185, 186, 187, 189, 190, 191, 193, 194, 195,
+            197, 198, 199, 200, 202, 203, 204, 205, 207, 208, 209, 210, 211, 213, 214, 215,
+            216, 217, 218, 219, 220, 221, 223, 224, 225, 226, 227, 228, 229, 230, 231, 231,
+            232, 233, 234, 235, 236, 237, 238, 238, 239, 240, 241, 242, 242, 243, 244, 244,
+            245, 246, 246, 247, 247, 248, 249, 249, 250, 250, 251, 251, 252, 252, 252, 253,
+            253, 253, 254, 254, 254, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+        };
+        return table;
+    }
+
+    inline uint8_t lerp8(uint8_t a, uint8_t b, uint8_t frac)
+    {
+        return a + (((int16_t)(b - a) * frac) >> 8);
+    }
+
+    inline uint8_t hash(uint8_t i) { return perm()[i]; }
+
+    /// Noise at x (8.8), 0-255
+    inline uint8_t noise1(uint16_t x)
+    {
+        uint8_t i = x >> 8;
+        uint8_t f = smooth()[x & 0xFF];
+        return lerp8(hash(i), hash(i + 1), f);
+    }
+
+    /// Noise at (x, y) (8.8 each), 0-255
+    inline uint8_t noise2(uint16_t x, uint16_t y)
+    {
+        const uint8_t *p = perm();
+        uint8_t ix = x >> 8, iy = y >> 8;
+        uint8_t fx = smooth()[x & 0xFF], fy = smooth()[y & 0xFF];
+        uint8_t a = p[ix] + iy, b = p[(uint8_t)(ix + 1)] + iy;
+        uint8_t lo = lerp8(p[a], p[b], fx);
+        uint8_t hi = lerp8(p[(uint8_t)(a + 1)], p[(uint8_t)(b + 1)], fx);
+        return lerp8(lo, hi, fy);
+    }
+
+    /// Noise at (x, y, z) (8.8 each), 0-255
+    inline uint8_t noise3(uint16_t x, uint16_t y, uint16_t z)
+    {
+        const uint8_t *p = perm();
+        uint8_t ix = x >> 8, iy = y >> 8, iz = z >> 8;
+        uint8_t fx = smooth()[x & 0xFF], fy = smooth()[y & 0xFF], fz = smooth()[z & 0xFF];
+        uint8_t a = p[ix] + iy, b = p[(uint8_t)(ix + 1)] + iy;
+        uint8_t aa = p[a] + iz, ab = p[(uint8_t)(a + 1)] + iz;
+        uint8_t ba = p[b] + iz, bb = p[(uint8_t)(b + 1)] + iz;
+        uint8_t near = lerp8(lerp8(p[aa], p[ba], fx), lerp8(p[ab], p[bb], fx), fy);
+        uint8_t far = lerp8(lerp8(p[(uint8_t)(aa + 1)], p[(uint8_t)(ba + 1)], fx),
+                            lerp8(p[(uint8_t)(ab + 1)], p[(uint8_t)(bb + 1)], fx), fy);
+        return lerp8(near, far, fz);
+    }
+
+    /**
+     * @brief Interpolated noise clusters around the middle; spread v from [64, 192]
+     *        over the full 0-255 range (clamped), for palettes that need both ends.
+     */
+    inline uint8_t stretch(uint8_t v)
+    {
+        int16_t s = ((int16_t)v - 64) * 2;
+        return s < 0 ? 0 : s > 255 ? 255 : s;
+    }
+} // namespace Noise
+
+#endif // NOISE_H
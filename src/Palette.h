@@ -0,0 +1,291 @@
+// File: Palette.h
+#ifndef PALETTE_H
+#define PALETTE_H
+
+#include <Arduino.h>
+#include <NeoPixelBus.h>
+
+/**
+ * @file Palette.h
+ * @brief Gradient palettes, expanded once into 256-entry color tables that effects index per pixel.
+ *
+ * A palette is described by up to PALETTE_MAX_STOPS gradient stops. Its compact binary
+ * form (the "blob") is 4 bytes per stop, position then R, G, B, with positions rising
+ * from 0 to 255. This is also the form the serial command loads and prints. load() expands the stops into
+ * a full table once, so an effect maps a byte (heat, noise, hue) to a color with a
+ * single lookup and never interpolates per pixel.
+ *
+ * The PaletteBank holds a fixed number of tables: the built-ins of PALETTE_LIST, then
+ * free slots for blobs loaded at run time. Segments select a slot; each effect names
+ * the built-in it uses when the segment has none selected.
+ */
+
+/// Stops a palette may have
+#ifndef PALETTE_MAX_STOPS
+#define PALETTE_MAX_STOPS 16
+#endif
+/// Palette tables in the bank, built-ins included (each costs 768 B for the table plus the stops)
+#ifndef PALETTE_SLOTS
+#define PALETTE_SLOTS 8
+#endif
+
+namespace PaletteBlobs
+{
+    // Format: {position, R, G, B} per stop
+    static const uint8_t HEAT[] = {0, 0, 0, 0, 85, 255, 0, 0, 170, 255, 255, 0, 255, 255, 255, 255};
+    static const uint8_t RAINBOW[] = {0, 255, 0, 0, 43, 255, 255, 0, 85, 0, 255, 0, 128, 0, 255, 255,
+                                      171, 0, 0, 255, 213, 255, 0, 255, 255, 255, 0, 0};
+    static const uint8_t LAVA[] = {0, 0, 0, 0, 85, 160, 0, 0, 170, 255, 80, 0, 255, 255, 200, 40};
+    static const uint8_t OCEAN[] = {0, 0, 0, 40, 85, 0, 40, 140, 170, 0, 150, 200, 255, 180, 240, 255};
+    static const uint8_t FOREST[] = {0, 0, 20, 0, 96, 0, 100, 20, 160, 60, 140, 0, 255, 180, 220, 60};
+    static const uint8_t PARTY[] = {0, 90, 0, 200, 64, 255, 0, 80, 128, 255, 120, 0, 192, 0, 80, 255, 255, 90, 0, 200};
+} // namespace PaletteBlobs
+
+/// Built-in palettes, loaded into the first bank slots. Format: X(ENUM_NAME, "command name", blob)
+#define PALETTE_LIST(X)                       \
+    X(HEAT, "heat", PaletteBlobs::HEAT)       \
+    X(RAINBOW, "rainbow", PaletteBlobs::RAINBOW) \
+    X(LAVA, "lava", PaletteBlobs::LAVA)       \
+    X(OCEAN, "ocean", PaletteBlobs::OCEAN)    \
+    X(FOREST, "forest", PaletteBlobs::FOREST) \
+    X(PARTY, "party", PaletteBlobs::PARTY)
+
+/**
+ * @class Palette
+ * @brief Gradient stops and the 256-entry table expanded from them.
+ */
+class Palette
+{
+public:
+    Palette() : _table(), _stopCount(0) {}
+
+    /**
+     * @brief Replace the stops with a blob and expand the table.
+     * @return false (palette unchanged) unless len is 4 to 4 * PALETTE_MAX_STOPS bytes,
+     *         a whole number of stops, with non-decreasing positions.
+     */
+    bool load(const uint8_t *blob, size_t len)
+    {
+        if (len < 4 || len % 4 || len > sizeof(_stops))
+        {
+            return false;
+        }
+        for (size_t i = 4; i < len; i += 4)
+        {
+            if (blob[i] < blob[i - 4])
+                return false;
+        }
+        memcpy(_stops, blob, len);
+        _stopCount = len / 4;
+        expand();
+        return true;
+    }
+
+    /// Copy the blob to out (at most cap bytes); returns its length
+    size_t save(uint8_t *out, size_t cap) const
+    {
+        size_t len = (size_t)_stopCount * 4;
+        memcpy(out, _stops, len < cap ? len : cap);
+        return len;
+    }
+
+    uint8_t stopCount() const { return _stopCount; }
+
+    /// True if the palette holds exactly the stops of this blob
+    bool holds(const uint8_t *blob, size_t len) const
+    {
+        return len == (size_t)_stopCount * 4 && memcmp(_stops, blob, len) == 0;
+    }
+
+    /// The expanded table: index 0-255 -> color
+    inline const RgbColor *table() const { return _table; }
+    inline const RgbColor &operator[](uint8_t i) const { return _table[i]; }
+
+private:
+    // Linear interpolation between neighboring stops; before the first and after the last
+    // stop the table holds their color
+    void expand()
+    {
+        const uint8_t *s = _stops;
+        const uint8_t *last = _stops + (_stopCount - 1) * 4;
+        for (uint16_t i = 0; i < 256; ++i)
+        {
+            while (s < last && i > s[4])
+            {
+                s += 4;
+            }
+            if (s == last || i <= s[0])
+            {
+                _table[i] = RgbColor(s[1], s[2], s[3]);
+                continue;
+            }
+            uint16_t span = s[4] - s[0]; // > 0 here, since s[0] < i <= s[4]
+            uint16_t f = ((i - s[0]) * 256 + span / 2) / span;
+            _table[i] = RgbColor(mix(s[1], s[5], f), mix(s[2], s[6], f), mix(s[3], s[7], f));
+        }
+    }
+
+    static inline uint8_t mix(uint8_t a, uint8_t b, uint16_t f) // f in 1/256, 0-256
+    {
+        return a + (((int16_t)(b - a) * (int16_t)f + 128) >> 8);
+    }
+
+    RgbColor _table[256];
+    uint8_t _stops[PALETTE_MAX_STOPS * 4];
+    uint8_t _stopCount;
+};
+
+/**
+ * @class PaletteBank
+ * @brief Fixed set of palette slots: the built-ins first, then slots for loaded blobs.
+ */
+class PaletteBank
+{
+public:
+    enum Builtin : uint8_t
+    {
+#define PALETTE_ENUM_ENTRY(name, label, blob) name,
+        PALETTE_LIST(PALETTE_ENUM_ENTRY)
+#undef PALETTE_ENUM_ENTRY
+            BUILTIN_COUNT
+    };
+    static_assert(BUILTIN_COUNT <= PALETTE_SLOTS, "PALETTE_SLOTS must hold the built-in palettes");
+
+    /// Segment setting for "the effect's own palette"
+    static const uint8_t NONE = 0xFF;
+
+    PaletteBank()
+    {
+        uint8_t slot = 0;
+#define PALETTE_LOAD_ENTRY(name, label, blob) _slots[slot++].load(blob, sizeof(blob));
+        PALETTE_LIST(PALETTE_LOAD_ENTRY)
+#undef PALETTE_LOAD_ENTRY
+        for (; slot < PALETTE_SLOTS; ++slot)
+        {
+            _slots[slot].load(PaletteBlobs::HEAT, sizeof(PaletteBlobs::HEAT)); // Until a blob is loaded
+        }
+    }
+
+    /// Table of slot (any out-of-range slot gives slot 0)
+    inline const RgbColor *table(uint8_t slot) const { return _slots[slot < PALETTE_SLOTS ? slot : 0].table(); }
+
+    Palette &operator[](uint8_t slot) { return _slots[slot < PALETTE_SLOTS ? slot : 0]; }
+
+    /// Name of a built-in slot, "user" for the others
+    static const char *name(uint8_t slot)
+    {
+        static const char *const names[] = {
+#define PALETTE_NAME_ENTRY(name, label, blob) label,
+            PALETTE_LIST(PALETTE_NAME_ENTRY)
+#undef PALETTE_NAME_ENTRY
+        };
+        return slot < BUILTIN_COUNT ? names[slot] : "user";
+    }
+
+    /// Slot of a name or number ("heat", "3"), or NONE
+    static uint8_t find(const String &s)
+    {
+        if (s.length() > 0 && isdigit(s.charAt(0)))
+        {
+            int slot = s.toInt();
+            return slot < PALETTE_SLOTS ? slot : NONE;
+        }
+        for (uint8_t i = 0; i < BUILTIN_COUNT; ++i)
+        {
+            if (s.equalsIgnoreCase(name(i)))
+                return i;
+        }
+        return NONE;
+    }
+
+    /// One line per slot: number, name, stops and blob in hex
+    void report(Print &out) const
+    {
+        for (uint8_t i = 0; i < PALETTE_SLOTS; ++i)
+        {
+            printSlot(out, i);
+        }
+    }
+
+    void printSlot(Print &out, uint8_t slot) const
+    {
+        uint8_t blob[PALETTE_MAX_STOPS * 4];
+        size_t len = _slots[slot].save(blob, sizeof(blob));
+        char line[24 + PALETTE_MAX_STOPS * 9];
+        int n = snprintf(line, sizeof(line), "Palette %u (%s), %u stops:", (unsigned)slot, name(slot),
+                         (unsigned)_slots[slot].stopCount());
+        for (size_t i = 0; i < len && n < (int)sizeof(line) - 3; ++i)
+        {
+            n += snprintf(line + n, sizeof(line) - n, i % 4 ? "%02X" : " %02X", blob[i]);
+        }
+        out.println(line);
+    }
+
+    /**
+     * @brief Handle the parameters of a `palette` serial command.
+     * @param params "" lists the slots; "<slot>" prints one; "<slot> <hex blob>" loads a
+     *               blob (spaces between hex digits are ignored) into a slot after the built-ins.
+     */
+    void handleCommand(const String &params)
+    {
+        if (params.length() == 0)
+        {
+            report(Serial);
+            return;
+        }
+        int space = params.indexOf(' ');
+        uint8_t slot = find(space == -1 ? params : params.substring(0, space));
+        if (slot == NONE)
+        {
+            Serial.println("Invalid format. Use: palette [<slot> [<hex blob>]]");
+            return;
+        }
+        if (space != -1)
+        {
+            uint8_t blob[PALETTE_MAX_STOPS * 4];
+            size_t len = 0;
+            bool ok = slot >= BUILTIN_COUNT && parseHex(params.c_str() + space + 1, blob, sizeof(blob), len) &&
+                      _slots[slot].load(blob, len);
+            if (!ok)
+            {
+                Serial.print("Blob not loaded: it must be 1-16 stops of 4 hex bytes (position R G B, positions rising), into slot ");
+                Serial.print(BUILTIN_COUNT);
+                Serial.print("-");
+                Serial.println(PALETTE_SLOTS - 1);
+                return;
+            }
+        }
+        printSlot(Serial, slot);
+    }
+
+private:
+    static bool parseHex(const char *s, uint8_t *out, size_t cap, size_t &len)
+    {
+        len = 0;
+        int high = -1;
+        for (; *s; ++s)
+        {
+            if (*s == ' ')
+                continue;
+            if (!isxdigit(*s))
+                return false;
+            int v = isdigit(*s) ? *s - '0' : (toupper(*s) - 'A' + 10);
+            if (high < 0)
+            {
+                high = v;
+            }
+            else
+            {
+                if (len == cap)
+                    return false;
+                out[len++] = (uint8_t)(high << 4 | v);
+                high = -1;
+            }
+        }
+        return high < 0;
+    }
+
+    Palette _slots[PALETTE_SLOTS];
+};
+
+#endif // PALETTE_H
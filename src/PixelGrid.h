@@ -0,0 +1,77 @@
+// File: PixelGrid.h
+#ifndef PIXELGRID_H
+#define PIXELGRID_H
+
+#include "PixelSpan.h"
+
+/**
+ * @file PixelGrid.h
+ * @brief Two-dimensional view over one segment's layer buffer.
+ *
+ * A segment declared as a width x height grid (Segment::setGrid) stores its cells row by
+ * row: cell (x, y) is layer pixel y * width + x, and row y is a plain PixelSpan. 2D effects
+ * build a grid over the span they are given and work either per cell or a row at a time;
+ * no index math is repeated per pixel. How the rows sit on the physical LEDs (serpentine,
+ * vertical wiring, several panels) is the PixelMap's job: its table is built once by
+ * `map matrix` and applied in the output pass, so effects never see the wiring.
+ *
+ * Without a grid the view is a single row of span.size() cells, so 2D effects still run
+ * (degenerately) on plain strips.
+ */
+
+/**
+ * @class BasicPixelGrid
+ * @brief Row-major (x, y) access to a span.
+ * @tparam T_FEATURE The NeoPixelBus color feature (byte order) of the underlying buffer.
+ */
+template <typename T_FEATURE>
+class BasicPixelGrid
+{
+public:
+    typedef BasicPixelSpan<T_FEATURE> Span;
+    typedef typename T_FEATURE::ColorObject ColorObject;
+
+    /// Grid over the first width * height pixels of span; one row of span.size() if that does not fit
+    BasicPixelGrid(Span span, uint16_t width, uint16_t height) : _span(span), _width(width), _height(height)
+    {
+        if (width == 0 || height == 0 || (uint32_t)width * height > span.size())
+        {
+            _width = span.size();
+            _height = 1;
+        }
+    }
+
+    inline uint16_t width() const { return _width; }
+    inline uint16_t height() const { return _height; }
+
+    /// Cells in the grid (width * height)
+    inline uint16_t size() const { return _width * _height; }
+
+    /// Index of cell (x, y) in the span (both already within the grid)
+    inline uint16_t index(uint16_t x, uint16_t y) const { return y * _width + x; }
+
+    /// True if signed coordinates fall inside the grid
+    inline bool contains(int x, int y) const { return x >= 0 && x < _width && y >= 0 && y < _height; }
+
+    /// Row y (0 = top) as a span of width() pixels
+    inline Span row(uint16_t y) const { return _span.subSpan(index(0, y), _width); }
+
+    /// Write cell (x, y) (within the grid)
+    inline void set(uint16_t x, uint16_t y, const ColorObject &color) { _span.set(index(x, y), color); }
+
+    /// Read cell (x, y) (within the grid)
+    inline ColorObject get(uint16_t x, uint16_t y) const { return _span.get(index(x, y)); }
+
+    /// The whole grid as one span, row after row
+    inline Span span() const { return _span.subSpan(0, size()); }
+
+    /// Turn every cell off
+    inline void clear() { span().clear(); }
+
+private:
+    Span _span;
+    uint16_t _width;
+    uint16_t _height;
+};
+
+#endif // PIXELGRID_H
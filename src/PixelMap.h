@@ -0,0 +1,243 @@
+// File: PixelMap.h
+#ifndef PIXEL_MAP_H
+#define PIXEL_MAP_H
+
+#include <Arduino.h>
+#include "Raster.h"
+
+/**
+ * @file PixelMap.h
+ * @brief Optional logical-to-physical LED remap, applied once in the output stage.
+ *
+ * Effects and the compositor always work in logical order. Without a layout, logical
+ * pixel i is physical LED i and the output pass reads the frame straight through. Once a
+ * layout is described (runs, optionally reversed, and matrices, optionally serpentine),
+ * the map holds one logical index per physical LED and the output pass reads each LED's
+ * color through it: one table lookup per pixel at show time. Physical LEDs that no run
+ * covers stay dark, which is how gaps in a strip are skipped.
+ *
+ * The table is allocated the first time a layout is described and reused afterwards.
+ */
+
+/**
+ * @class PixelMap
+ * @brief Layout description and the physical-to-logical lookup table built from it.
+ */
+class PixelMap
+{
+public:
+    /// Table entry of a physical LED that shows nothing
+    static const uint16_t NONE = Raster::UNMAPPED;
+
+    PixelMap() : _table(nullptr), _count(0), _active(false), _changed(false)
+    {
+        _matrix = {0, 0, 0};
+    }
+    ~PixelMap() { delete[] _table; }
+
+    /// Number of physical LEDs; set once by the strip
+    void begin(uint16_t count) { _count = count; }
+
+    /// Physical LED -> logical pixel (NONE = dark), or nullptr while the layout is the identity
+    inline const uint16_t *table() const { return _active ? _table : nullptr; }
+
+    /// Heap used by the table
+    size_t tableBytes() const { return _table ? (size_t)_count * sizeof(uint16_t) : 0; }
+
+    /// Back to the identity layout
+    void reset()
+    {
+        _active = false;
+        _matrix = {0, 0, 0};
+        _changed = true;
+    }
+
+    /**
+     * @brief Show count logical pixels from logicalStart on the physical LEDs from
+     *        physicalStart, in the same or (reversed) opposite direction.
+     */
+    bool mapRun(uint16_t logicalStart, uint16_t physicalStart, uint16_t count, bool reversed)
+    {
+        if (!fits(logicalStart, count) || !fits(physicalStart, count) || !activate())
+        {
+            return false;
+        }
+        for (uint16_t i = 0; i < count; ++i)
+        {
+            _table[physicalStart + (reversed ? count - 1 - i : i)] = logicalStart + i;
+        }
+        return true;
+    }
+
+    /**
+     * @brief Show a width x height block of logical pixels, row by row from logicalStart
+     *        (see XY()), on a matrix wired from physicalStart.
+     * @param serpentine Every other line is wired in the opposite direction (zig-zag).
+     * @param vertical The wiring runs along columns instead of rows.
+     */
+    bool mapMatrix(uint16_t logicalStart, uint16_t physicalStart, uint16_t width, uint16_t height,
+                   bool serpentine, bool vertical)
+    {
+        uint32_t count = (uint32_t)width * height;
+        if (count == 0 || count > _count || !fits(logicalStart, count) || !fits(physicalStart, count) ||
+            !activate())
+        {
+            return false;
+        }
+        uint16_t lineLength = vertical ? height : width;
+        for (uint16_t y = 0; y < height; ++y)
+        {
+            for (uint16_t x = 0; x < width; ++x)
+            {
+                uint16_t line = vertical ? x : y;
+                uint16_t pos = vertical ? y : x;
+                if (serpentine && (line & 1))
+                {
+                    pos = lineLength - 1 - pos;
+                }
+                _table[physicalStart + (uint32_t)line * lineLength + pos] = logicalStart + (uint32_t)y * width + x;
+            }
+        }
+        _matrix = {logicalStart, width, height};
+        return true;
+    }
+
+    /**
+     * @brief Logical index of matrix cell (x, y) of the last mapMatrix(), NONE outside it.
+     *        Row-major, so effects can treat each row as a straight run.
+     */
+    inline uint16_t XY(uint16_t x, uint16_t y) const
+    {
+        return x < _matrix.width && y < _matrix.height ? _matrix.start + y * _matrix.width + x : NONE;
+    }
+    uint16_t width() const { return _matrix.width; }
+    uint16_t height() const { return _matrix.height; }
+
+    /// True after the layout changed until markApplied(), so the output gets rebuilt
+    bool changed() const { return _changed; }
+    void markApplied() { _changed = false; }
+
+    void report(Print &out) const
+    {
+        if (!_active)
+        {
+            out.println("Pixel map: identity");
+            return;
+        }
+        uint16_t mapped = 0;
+        for (uint16_t i = 0; i < _count; ++i)
+        {
+            mapped += _table[i] != NONE;
+        }
+        char line[96];
+        snprintf(line, sizeof(line), "Pixel map: %u of %u LEDs mapped", (unsigned)mapped, (unsigned)_count);
+        out.print(line);
+        if (_matrix.width)
+        {
+            snprintf(line, sizeof(line), ", matrix %ux%u at logical %u", (unsigned)_matrix.width,
+                     (unsigned)_matrix.height, (unsigned)_matrix.start);
+            out.print(line);
+        }
+        out.println();
+    }
+
+    /**
+     * @brief Handle the parameters of a `map` serial command.
+     * @param params "" prints the layout; "reset"; "run <logical> <physical> <count> [rev]";
+     *               "matrix <logical> <physical> <width> <height> [serpentine] [vertical]".
+     */
+    void handleCommand(const String &params)
+    {
+        int a = 0, b = 0, c = 0, d = 1;
+        char f1[12] = "", f2[12] = "";
+        bool ok = true;
+        bool parsed = false;
+        if (params.length() == 0)
+        {
+            report(Serial);
+            return;
+        }
+        else if (params.equalsIgnoreCase("reset"))
+        {
+            reset();
+        }
+        else if (params.startsWith("run ") && sscanf(params.c_str() + 4, "%d %d %d %11s", &a, &b, &c, f1) >= 3)
+        {
+            parsed = true;
+            ok = argsFit(a, b, c, d) && mapRun(a, b, c, strcmp(f1, "rev") == 0);
+        }
+        else if (params.startsWith("matrix ") &&
+                 sscanf(params.c_str() + 7, "%d %d %d %d %11s %11s", &a, &b, &c, &d, f1, f2) >= 4)
+        {
+            parsed = true;
+            bool serpentine = strcmp(f1, "serpentine") == 0 || strcmp(f2, "serpentine") == 0;
+            bool vertical = strcmp(f1, "vertical") == 0 || strcmp(f2, "vertical") == 0;
+            ok = argsFit(a, b, c, d) && mapMatrix(a, b, c, d, serpentine, vertical);
+        }
+        else
+        {
+            Serial.println("Invalid format. Use: map [reset|run <logical> <physical> <count> [rev]|"
+                           "matrix <logical> <physical> <w> <h> [serpentine] [vertical]]");
+            return;
+        }
+        if (parsed && !argsFit(a, b, c, d))
+        {
+            Serial.print("Error: starts must be 0 to ");
+            Serial.print(_count - 1);
+            Serial.print(" and sizes 1 to ");
+            Serial.println(_count);
+        }
+        else if (!ok)
+        {
+            Serial.println("Map entry does not fit the strip.");
+        }
+        report(Serial);
+    }
+
+private:
+    inline bool fits(uint32_t start, uint32_t count) const { return start + count <= _count; }
+
+    // Parsed command values are LEDs of the strip and sizes of 1 to its length, so none of
+    // them wraps when narrowed to uint16_t
+    bool argsFit(int logical, int physical, int size1, int size2) const
+    {
+        return logical >= 0 && logical < _count && physical >= 0 && physical < _count && size1 > 0 &&
+               size1 <= _count && size2 > 0 && size2 <= _count;
+    }
+
+    // Allocate the table once; the first entry after reset() starts from all dark
+    bool activate()
+    {
+        if (!_table)
+        {
+            _table = new uint16_t[_count];
+            if (!_table)
+                return false;
+        }
+        if (!_active)
+        {
+            for (uint16_t i = 0; i < _count; ++i)
+            {
+                _table[i] = NONE;
+            }
+            _active = true;
+        }
+        _changed = true;
+        return true;
+    }
+
+    struct Matrix
+    {
+        uint16_t start;
+        uint16_t width;
+        uint16_t height;
+    };
+
+    uint16_t *_table;
+    uint16_t _count;
+    Matrix _matrix;
+    bool _active;
+    bool _changed;
+};
+
+#endif // PIXEL_MAP_H
@@ -0,0 +1,71 @@
+// File: PixelSpan.h
+#ifndef PIXELSPAN_H
+#define PIXELSPAN_H
+
+#include <Arduino.h>
+#include <NeoPixelBus.h>
+
+/**
+ * @file PixelSpan.h
+ * @brief View over one segment's layer buffer.
+ *
+ * A span is built once per rendered frame by PixelStrip::Segment::pixels(), over the
+ * segment's layer (already clamped to the bus length). Indices are relative to the
+ * segment start and are not checked again, so per-pixel loops compile down to direct
+ * writes in the span feature's byte order (canonical RGB for layers; the compositor
+ * converts to the wire format). Whoever renders into a layer marks it dirty after.
+ * Bulk operations (fill, gradient, hue ramps, blit, fade) live in Raster.h.
+ */
+
+/**
+ * @class BasicPixelSpan
+ * @brief Segment-relative pixel access for one NeoPixelBus color feature.
+ * @tparam T_FEATURE The NeoPixelBus color feature (byte order) of the underlying buffer.
+ */
+template <typename T_FEATURE>
+class BasicPixelSpan
+{
+public:
+    typedef typename T_FEATURE::ColorObject ColorObject;
+
+    BasicPixelSpan(uint8_t *pixels, uint16_t length) : _pixels(pixels), _length(length) {}
+
+    /// Number of pixels in the span
+    inline uint16_t size() const { return _length; }
+
+    /// Raw bytes of the first pixel, in the feature's wire order (PixelSize bytes per pixel)
+    inline uint8_t *data() const { return _pixels; }
+
+    /// Sub-span of count pixels starting at first (both already within the span)
+    inline BasicPixelSpan subSpan(uint16_t first, uint16_t count) const
+    {
+        return BasicPixelSpan(_pixels + (size_t)first * T_FEATURE::PixelSize, count);
+    }
+
+    /// True if a signed segment-relative index falls inside the span
+    inline bool contains(int idx) const { return idx >= 0 && idx < _length; }
+
+    /// Write pixel idx (0 <= idx < size())
+    inline void set(uint16_t idx, const ColorObject &color)
+    {
+        T_FEATURE::applyPixelColor(_pixels, idx, color);
+    }
+
+    /// Read pixel idx (0 <= idx < size())
+    inline ColorObject get(uint16_t idx) const
+    {
+        return T_FEATURE::retrievePixelColor(_pixels, idx);
+    }
+
+    /// Turn every pixel off
+    inline void clear()
+    {
+        memset(_pixels, 0, (size_t)_length * T_FEATURE::PixelSize);
+    }
+
+private:
+    uint8_t *_pixels;
+    uint16_t _length;
+};
+
+#endif // PIXELSPAN_H
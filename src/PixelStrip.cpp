@@ -1,4 +1,6 @@
 #include "PixelStrip.h"
+#include "Profiler.h"
+#include "MemoryReport.h"
 #include "effects/RainbowChase.h"
 #include "effects/SolidColor.h"
 #include "effects/FlashOnTrigger.h"
@@ -9,44 +11,455 @@
 #include "effects/ColoredFire.h"
 #include "effects/AccelMeter.h"
 #include "effects/KineticRipple.h"
+#include "effects/Fire2D.h"
+#include "effects/KineticRipple2D.h"
+#include "effects/Lava.h"
+#include "effects/Ocean.h"
+#include <new>
+#include <type_traits>
+
+// Every effect State must fit the segment's state block, and the block carries no slack.
+constexpr size_t largestEffectState()
+{
+    size_t largest = 0;
+#define EFFECT_STATE_SIZE(name, className) \
+    largest = sizeof(className::State) > largest ? sizeof(className::State) : largest;
+    EFFECT_LIST(EFFECT_STATE_SIZE)
+#undef EFFECT_STATE_SIZE
+    return largest;
+}
+static_assert(largestEffectState() == EFFECT_STATE_BYTES, "EFFECT_STATE_BYTES must equal the largest Effect::State");
+
+#define EFFECT_STATE_CHECK(name, className)                                                  \
+    static_assert(std::is_trivially_destructible<className::State>::value,                  \
+                  #className "::State must be trivially destructible");                     \
+    static_assert(alignof(className::State) <= 4, #className "::State needs too much alignment");
+EFFECT_LIST(EFFECT_STATE_CHECK)
+#undef EFFECT_STATE_CHECK
+
+// Each effect namespace provides params(), start(seg, State&) and render(seg, State&, PixelSpan).
+// EffectDriver binds them as template arguments, so the effect body is inlined into one
+// thunk per effect and the table below is filled at compile time.
+typedef PixelStrip::Segment Segment;
+
+struct EffectOps
+{
+    void (*start)(Segment &seg);
+    void (*render)(Segment &seg, PixelSpan px);
+    ParamList (*params)();
+};
+
+template <typename S,
+          void (*Start)(Segment *, S &),
+          void (*Render)(Segment *, S &, PixelSpan)>
+struct EffectDriver
+{
+    static void start(Segment &seg)
+    {
+        S *st = new (&seg.state<S>()) S();
+        Start(&seg, *st);
+    }
+
+    static void render(Segment &seg, PixelSpan px)
+    {
+        Render(&seg, seg.state<S>(), px);
+    }
+};
+
+static constexpr EffectOps EFFECT_OPS[] = {
+    {nullptr, nullptr, nullptr}, // NONE
+#define EFFECT_OPS_ENTRY(name, className)                                                                 \
+    {&EffectDriver<className::State, &className::start, &className::render>::start,                       \
+     &EffectDriver<className::State, &className::start, &className::render>::render,                      \
+     &className::params},
+    EFFECT_LIST(EFFECT_OPS_ENTRY)
+#undef EFFECT_OPS_ENTRY
+};
+static_assert(sizeof(EFFECT_OPS) / sizeof(EFFECT_OPS[0]) == static_cast<size_t>(Segment::SegmentEffect::EFFECT_COUNT),
+              "EFFECT_OPS must have one entry per SegmentEffect");
 
 //================================================================================
 // PixelStrip Class Methods
 //================================================================================
 
 PixelStrip::PixelStrip(uint8_t pin, uint16_t ledCount, uint8_t brightness, uint8_t numSections)
-    : strip(ledCount, pin)
 {
-    segments_.push_back(new Segment(*this, 0, ledCount - 1, String("all"), 0));
-    segments_[0]->setBrightness(brightness);
+#ifdef PIXELSTRIP_CLOCK_PIN
+    OutputConfig output = {pin, ledCount, PIXELSTRIP_CLOCK_PIN};
+#else
+    OutputConfig output = {pin, ledCount, 0};
+#endif
+    init(&output, 1, brightness, numSections);
+}
+
+PixelStrip::PixelStrip(const OutputConfig *outputs, uint8_t outputCount, uint8_t brightness, uint8_t numSections)
+{
+    init(outputs, outputCount, brightness, numSections);
+}
+
+// Construct the buses in the output pool, end to end in logical pixel space, then the default segments.
+// The "all" segment needs a layer as long as every output together, so LEDs past
+// PIXELSTRIP_LAYER_PIXELS are cut from the output that crosses it and later outputs are dropped.
+void PixelStrip::init(const OutputConfig *outputs, uint8_t outputCount, uint8_t brightness, uint8_t numSections)
+{
+    uint8_t requested = outputCount < PIXELSTRIP_MAX_OUTPUTS ? outputCount : PIXELSTRIP_MAX_OUTPUTS;
+    for (uint8_t i = 0; i < requested; ++i)
+    {
+        uint16_t room = PIXELSTRIP_LAYER_PIXELS - pixelCount_;
+        uint16_t leds = outputs[i].ledCount < room ? outputs[i].ledCount : room;
+        droppedPixels_ += outputs[i].ledCount - leds;
+        if (leds == 0)
+            continue;
+        outputStart_[outputCount_] = pixelCount_;
+        outputPin_[outputCount_] = outputs[i].pin;
+#ifdef PIXELSTRIP_CLOCK_PIN
+        new (outputAt(outputCount_)) PixelBus(leds, outputs[i].clockPin, outputs[i].pin);
+#else
+        new (outputAt(outputCount_)) PixelBus(leds, outputs[i].pin);
+#endif
+        ++outputCount_;
+        pixelCount_ += leds;
+    }
+    uint16_t ledCount = pixelCount_;
+    pixelMap_.begin(ledCount);
+
+    power_.setChannelCurrents<PixelFeature>(POWER_CHANNEL_MA, POWER_CHANNEL_MA, POWER_CHANNEL_MA);
+#if PIXELSTRIP_HIGH_PRECISION
+    size_t channels = (size_t)ledCount * WireChannels::Channels;
+    wide_ = new uint16_t[(size_t)ledCount * PixelFeature::PixelSize]();
+    residual_ = new uint8_t[channels];
+    for (size_t i = 0; i < channels; ++i)
+    {
+        residual_[i] = (uint8_t)(i * 158); // ~0.618 turn apart, so neighbors do not step in unison
+    }
+#else
+    if (outputCount_ > 1)
+    {
+        frame_ = new uint8_t[(size_t)ledCount * PixelFeature::PixelSize]();
+    }
+#endif
+    if (!addSection(0, ledCount - 1, "all"))
+        return; // Only with no outputs or PIXELSTRIP_MAX_SEGMENTS 0
+    segmentAt(0)->setBrightness(brightness);
 
     if (numSections > 0)
     {
         uint16_t per = ledCount / numSections;
+        char name[SEGMENT_NAME_LEN];
         for (uint8_t s = 0; s < numSections; ++s)
         {
             uint16_t start = s * per;
             uint16_t end = (s == numSections - 1) ? (ledCount - 1) : (start + per - 1);
-            segments_.push_back(new Segment(*this, start, end, String("seg") + String(s + 1), s + 1));
+            snprintf(name, sizeof(name), "seg%u", (unsigned)(s + 1));
+            addSection(start, end, name);
+        }
+    }
+}
+
+PixelStrip::~PixelStrip()
+{
+    for (uint8_t i = 0; i < segmentCount_; ++i)
+    {
+        segmentAt(i)->~Segment();
+    }
+#if PIXELSTRIP_HIGH_PRECISION
+    delete[] wide_;
+    delete[] residual_;
+#else
+    delete[] frame_;
+#endif
+    for (uint8_t i = 0; i < outputCount_; ++i)
+    {
+        outputAt(i)->~PixelBus();
+    }
+}
+
+// Construct a segment in the next free pool slot; its id is the slot index.
+// Its layer takes the part of [start, end] that lies on the bus from the arena.
+bool PixelStrip::addSection(uint16_t start, uint16_t end, const char *name)
+{
+    uint16_t count = pixelCount_;
+    uint16_t first = start < count ? start : count;
+    uint16_t last = end < count ? end + 1 : count;
+    uint16_t length = last > first ? last - first : 0;
+    if (segmentCount_ >= PIXELSTRIP_MAX_SEGMENTS || length > PIXELSTRIP_LAYER_PIXELS - layerPixelsUsed_)
+    {
+        return false;
+    }
+    new (segmentAt(segmentCount_)) Segment(*this, start, end, name, segmentCount_, layerPixelsUsed_, length);
+    memset(layerArena_ + (size_t)layerPixelsUsed_ * PixelFeature::PixelSize, 0, (size_t)length * PixelFeature::PixelSize);
+    layerPixelsUsed_ += length;
+    ++segmentCount_;
+    layoutDirty_ = true;
+    return true;
+}
+
+PixelStrip::Segment *PixelStrip::addOffscreenSection(uint16_t length, const char *name)
+{
+    if (length == 0 || segmentCount_ >= PIXELSTRIP_MAX_SEGMENTS || length > PIXELSTRIP_LAYER_PIXELS - layerPixelsUsed_)
+    {
+        return nullptr;
+    }
+    uint16_t start = pixelCount_; // relayout() marks layers past the outputs occluded
+    Segment *s = new (segmentAt(segmentCount_))
+        Segment(*this, start, start + length - 1, name, segmentCount_, layerPixelsUsed_, length);
+    memset(layerArena_ + (size_t)layerPixelsUsed_ * PixelFeature::PixelSize, 0, (size_t)length * PixelFeature::PixelSize);
+    layerPixelsUsed_ += length;
+    ++segmentCount_;
+    layoutDirty_ = true;
+    return s;
+}
+
+void PixelStrip::removeLastSection()
+{
+    if (segmentCount_ <= 1)
+    {
+        return;
+    }
+    Segment *s = segmentAt(--segmentCount_);
+    layerPixelsUsed_ = s->layerOffset;
+    s->~Segment();
+    layoutDirty_ = true;
+}
+
+void PixelStrip::begin()
+{
+    for (uint8_t i = 0; i < outputCount_; ++i)
+    {
+        outputAt(i)->Begin();
+    }
+}
+
+// Render every visible segment that is due, bottom layer first
+bool PixelStrip::update()
+{
+    if (layoutDirty_)
+    {
+        relayout();
+    }
+    unsigned long now = millis();
+    if (now - shareWindowStart_ >= 1000)
+    {
+        sharedPerSecond_ = sharedThisSecond_;
+        sharedThisSecond_ = 0;
+        shareWindowStart_ = now;
+    }
+    bool any = false; // Copies only happen when their source rendered
+    for (uint8_t i = 0; i < segmentCount_; ++i)
+    {
+        Segment *s = segmentAt(layerOrder_[i]);
+        if (s->shareFrom != Segment::NO_SHARE)
+        {
+            // The source is lower in z order, so it was updated earlier in this pass
+            Segment *src = segmentAt(s->shareFrom);
+            s->fresh = src->fresh;
+            if (src->fresh)
+            {
+                s->copyFrame(*src);
+                ++sharedThisSecond_;
+            }
+            continue;
+        }
+        s->fresh = s->update();
+        any |= s->fresh;
+    }
+    return any;
+}
+
+bool PixelStrip::show()
+{
+    PROFILE_SCOPE(Profiler::SITE_SHOW);
+    for (uint8_t i = 0; i < outputCount_; ++i)
+    {
+        if (!outputAt(i)->CanShow())
+        {
+            return false; // Previous frame still on a wire
+        }
+    }
+    if (layersDirty_ || layoutDirty_ || power_.changed() || pixelMap_.changed())
+    {
+        composite();
+    }
+#if PIXELSTRIP_HIGH_PRECISION
+    const uint16_t *map = pixelMap_.table();
+#endif
+    // Each Show() only starts the transfer, so converting output i + 1 overlaps sending output i
+    for (uint8_t i = 0; i < outputCount_; ++i)
+    {
+        PixelBus *bus = outputAt(i);
+#if PIXELSTRIP_HIGH_PRECISION
+        // Re-dither unchanged frames too, so the remainders keep averaging out
+        uint8_t *residual = residual_ + (size_t)outputStart_[i] * WireChannels::Channels;
+        if (map)
+        {
+            Raster::dither<WireFeature>(bus->Pixels(), wide_, residual, bus->PixelCount(), outputScale_,
+                                        map + outputStart_[i]);
+        }
+        else
+        {
+            Raster::dither<WireFeature>(bus->Pixels(), wide_ + (size_t)outputStart_[i] * PixelFeature::PixelSize,
+                                        residual, bus->PixelCount(), outputScale_);
+        }
+        bus->Dirty();
+#endif
+        bus->Show();
+    }
+    power_.noteFrame();
+    return true;
+}
+
+// Sort segments into z order and mark the ones hidden under opaque layers above them.
+void PixelStrip::relayout()
+{
+    for (uint8_t i = 0; i < segmentCount_; ++i)
+    {
+        uint8_t idx = i;
+        uint8_t j = i;
+        for (; j > 0 && segmentAt(layerOrder_[j - 1])->z > segmentAt(idx)->z; --j)
+        {
+            layerOrder_[j] = layerOrder_[j - 1];
+        }
+        layerOrder_[j] = idx;
+    }
+
+    // Walk from the top down, collecting the pixel ranges covered by opaque layers
+    uint16_t coverStart[PIXELSTRIP_MAX_SEGMENTS], coverEnd[PIXELSTRIP_MAX_SEGMENTS];
+    uint8_t covers = 0;
+    for (int8_t i = segmentCount_ - 1; i >= 0; --i)
+    {
+        Segment *s = segmentAt(layerOrder_[i]);
+        uint16_t first = s->startIdx;
+        uint16_t last = s->startIdx + s->layerLength; // exclusive
+
+        // Advance 'first' through the covered ranges; reaching 'last' means fully hidden
+        bool advanced = true;
+        while (first < last && advanced)
+        {
+            advanced = false;
+            for (uint8_t c = 0; c < covers; ++c)
+            {
+                if (coverStart[c] <= first && first < coverEnd[c])
+                {
+                    first = coverEnd[c];
+                    advanced = true;
+                }
+            }
+        }
+        s->occluded = s->layerLength > 0 && (first >= last || s->startIdx >= pixelCount_);
+        s->shareFrom = Segment::NO_SHARE;
+
+        if (!s->occluded && s->isOpaque() && s->layerLength > 0)
+        {
+            coverStart[covers] = s->startIdx;
+            coverEnd[covers] = last;
+            ++covers;
+        }
+    }
+
+    // Each visible segment copies the lowest visible twin below it, if any
+    for (uint8_t i = 1; i < segmentCount_; ++i)
+    {
+        Segment *s = segmentAt(layerOrder_[i]);
+        for (uint8_t j = 0; j < i; ++j)
+        {
+            Segment *src = segmentAt(layerOrder_[j]);
+            if (src->shareFrom == Segment::NO_SHARE && src->rendersLike(*s))
+            {
+                s->shareFrom = src->id;
+                break;
+            }
         }
     }
+    layoutDirty_ = false;
+    layersDirty_ = true;
 }
 
-void PixelStrip::addSection(uint16_t start, uint16_t end, const String &name)
+// Blend every visible layer into the bus buffer in one bottom-to-top pass, keeping the
+// output byte sums current, then scale the frame down if it exceeds the power budget
+void PixelStrip::composite()
+{
+    PROFILE_SCOPE(Profiler::SITE_COMPOSITE);
+    if (layoutDirty_)
+    {
+        relayout();
+    }
+#if PIXELSTRIP_HIGH_PRECISION
+    PixelSpan out(nullptr, pixelCount_);
+    memset(wide_, 0, (size_t)out.size() * PixelFeature::PixelSize * sizeof(uint16_t));
+#else
+    const uint16_t *map = pixelMap_.table();
+    if (map && !frame_)
+    {
+        frame_ = new uint8_t[(size_t)pixelCount_ * PixelFeature::PixelSize](); // First layout on a single output
+    }
+    // A single unmapped output composites canonical RGB in the front of its own buffer
+    PixelSpan out(frame_ ? frame_ : outputAt(0)->Pixels(), pixelCount_);
+    out.clear();
+#endif
+    power_.clearSums();
+    for (uint8_t i = 0; i < segmentCount_; ++i)
+    {
+        Segment *s = segmentAt(layerOrder_[i]);
+        if (!s->active || s->occluded || s->layerLength == 0)
+        {
+            continue;
+        }
+        // Brightness and gain scale the layer in one step, so the wide path keeps the fraction
+        uint8_t gain = (((uint32_t)s->brightness + 1) * ((uint32_t)s->gain + 1) - 1) >> 8;
+#if PIXELSTRIP_HIGH_PRECISION
+        Raster::blend(wide_ + (size_t)s->startIdx * PixelFeature::PixelSize, s->pixels(), s->blendMode,
+                      s->opacity, power_.sums(), gain);
+#else
+        Raster::blend(out.subSpan(s->startIdx, s->layerLength), s->pixels(), s->blendMode, s->opacity,
+                      power_.sums(), gain);
+#endif
+    }
+    outputScale_ = power_.limit(out.size(), outputBrightness_);
+#if !PIXELSTRIP_HIGH_PRECISION
+    uint32_t scale = (outputScale_ + 128) >> 8; // 1/256 steps for fade()
+    if (scale < 256)
+    {
+        Raster::fade(out, 256 - (scale ? scale : 1)); // Fading by 255/256 leaves every byte 0
+    }
+    for (uint8_t i = 0; i < outputCount_; ++i)
+    {
+        PixelBus *bus = outputAt(i);
+        if (map)
+        {
+            Raster::toWire<WireFeature>(bus->Pixels(), out.data(), bus->PixelCount(), map + outputStart_[i]);
+        }
+        else
+        {
+            Raster::toWire<WireFeature>(bus->Pixels(), out.subSpan(outputStart_[i], bus->PixelCount()).data(),
+                                        bus->PixelCount());
+        }
+        bus->Dirty();
+    }
+#endif
+    pixelMap_.markApplied();
+    layersDirty_ = false;
+}
+void PixelStrip::clear()
 {
-    uint8_t newId = segments_.size();
-    segments_.push_back(new Segment(*this, start, end, name, newId));
+    for (uint8_t i = 0; i < outputCount_; ++i)
+    {
+        outputAt(i)->ClearTo(Raster::wireColor<WireFeature>(RgbColor(0)));
+    }
 }
 
-void PixelStrip::begin() { strip.Begin(); }
-void PixelStrip::show()
+// Output holding logical pixel idx, with idx made relative to it; nullptr past the end
+PixelBus *PixelStrip::outputFor(uint16_t &idx) const
 {
-    if (strip.CanShow())
+    for (uint8_t i = outputCount_; i-- > 0;)
     {
-        strip.Show();
+        if (idx >= outputStart_[i])
+        {
+            idx -= outputStart_[i];
+            return idx < outputAt(i)->PixelCount() ? outputAt(i) : nullptr;
+        }
     }
+    return nullptr;
 }
-void PixelStrip::clear() { strip.ClearTo(RgbColor(0)); }
 
 uint32_t PixelStrip::Color(uint8_t r, uint8_t g, uint8_t b)
 {
@@ -57,12 +470,18 @@ void PixelStrip::setPixel(uint16_t i, uint32_t col)
 {
     RgbColor color((col >> 16) & 0xFF, (col >> 8) & 0xFF, col & 0xFF);
     color.Dim(activeBrightness_);
-    strip.SetPixelColor(i, color);
+    if (PixelBus *bus = outputFor(i))
+    {
+        bus->SetPixelColor(i, Raster::wireColor<WireFeature>(color));
+    }
 }
 
 void PixelStrip::clearPixel(uint16_t i)
 {
-    strip.SetPixelColor(i, RgbColor(0));
+    if (PixelBus *bus = outputFor(i))
+    {
+        bus->SetPixelColor(i, Raster::wireColor<WireFeature>(RgbColor(0)));
+    }
 }
 
 uint32_t PixelStrip::ColorHSV(uint16_t hue, uint8_t sat, uint8_t val)
@@ -72,47 +491,258 @@ uint32_t PixelStrip::ColorHSV(uint16_t hue, uint8_t sat, uint8_t val)
     return Color(rgb.R, rgb.G, rgb.B);
 }
 
+// Static and heap footprint of the strip, its segments and effect state (for the `mem` command)
+void PixelStrip::printMemoryUsage(Print &out) const
+{
+    uint32_t busBytes = 0;
+    for (uint8_t i = 0; i < outputCount_; ++i)
+    {
+        busBytes += outputAt(i)->PixelsSize();
+    }
+    MemoryReport::printFootprint(out, "Pixel buffer", busBytes);
+    char label[32];
+    snprintf(label, sizeof(label), "Segment pool (%u x %u B)", (unsigned)PIXELSTRIP_MAX_SEGMENTS,
+             (unsigned)sizeof(Segment));
+    MemoryReport::printFootprint(out, label, sizeof(segmentPool_));
+    MemoryReport::printFootprint(out, "Layer arena", sizeof(layerArena_));
+#if PIXELSTRIP_HIGH_PRECISION
+    MemoryReport::printFootprint(out, "16-bit output", (uint32_t)pixelCount_ * PixelFeature::PixelSize * sizeof(uint16_t));
+    MemoryReport::printFootprint(out, "Dither residual", (uint32_t)pixelCount_ * WireChannels::Channels);
+#else
+    if (frame_)
+    {
+        MemoryReport::printFootprint(out, "Output frame", (uint32_t)pixelCount_ * PixelFeature::PixelSize);
+    }
+#endif
+    if (pixelMap_.tableBytes())
+    {
+        MemoryReport::printFootprint(out, "Pixel map", pixelMap_.tableBytes());
+    }
+    MemoryReport::printFootprint(out, "Palettes", sizeof(palettes_));
+    MemoryReport::printFootprint(out, "Fire heat", sizeof(Fire::heat));
+    MemoryReport::printFootprint(out, "Flare heat", sizeof(Flare::flare_heat));
+    MemoryReport::printFootprint(out, "ColoredFire heat", sizeof(ColoredFire::heat));
+    MemoryReport::printFootprint(out, "ColoredFire tables", sizeof(ColoredFire::tables));
+    MemoryReport::printFootprint(out, "Fire2D heat", sizeof(Fire2D::heat));
+    MemoryReport::printFootprint(out, "Ripple2D distance", sizeof(KineticRipple2D::distance));
+}
+
+// Which segments copy another's frame, and how many renders that saved in the last second (for the `sharing` command)
+void PixelStrip::printSharing(Print &out) const
+{
+    char line[80];
+    uint8_t copies = 0;
+    for (uint8_t i = 0; i < segmentCount_; ++i)
+    {
+        const Segment *s = segmentAt(i);
+        if (s->shareFrom != Segment::NO_SHARE)
+        {
+            snprintf(line, sizeof(line), "Segment %u copies segment %u, phase %u", (unsigned)i, (unsigned)s->shareFrom,
+                     (unsigned)s->phase);
+            out.println(line);
+            ++copies;
+        }
+    }
+    snprintf(line, sizeof(line), "Render sharing: %u of %u segments copy, %u renders/s saved", (unsigned)copies,
+             (unsigned)segmentCount_, (unsigned)sharedPerSecond_);
+    out.println(line);
+}
+
 // --- REQUIRED: Implementations for missing functions ---
 void PixelStrip::setActiveBrightness(uint8_t b)
 {
     activeBrightness_ = b;
 }
-const std::vector<PixelStrip::Segment *> &PixelStrip::getSegments() const
+// Scale of the whole composited output, applied before the power budget
+void PixelStrip::setOutputBrightness(uint8_t b)
 {
-    return segments_;
+    outputBrightness_ = b;
+    layersDirty_ = true;
 }
+PixelStrip::SegmentList PixelStrip::getSegments() const
+{
+    return SegmentList(segmentAt(0), segmentCount_);
+}
+// First output; see getOutput() for the others
 PixelBus &PixelStrip::getStrip()
 {
-    return strip;
+    return *outputAt(0);
+}
+
+// Logical pixel range of each output (for the `outputs` command)
+void PixelStrip::printOutputs(Print &out) const
+{
+    char line[80];
+    for (uint8_t i = 0; i < outputCount_; ++i)
+    {
+        uint16_t count = outputAt(i)->PixelCount();
+        snprintf(line, sizeof(line), "Output %u: pin %u, pixels %u-%u (%u LEDs, %u bytes)", (unsigned)i,
+                 (unsigned)outputPin_[i], (unsigned)outputStart_[i], (unsigned)(outputStart_[i] + count - 1), (unsigned)count,
+                 (unsigned)outputAt(i)->PixelsSize());
+        out.println(line);
+    }
 }
 
 //================================================================================
 // PixelStrip::Segment Class Methods
 //================================================================================
 
-PixelStrip::Segment::Segment(PixelStrip &p, uint16_t s, uint16_t e, const String &n, uint8_t i)
-    : parent(p), startIdx(s), endIdx(e), name(n), id(i), brightness(255) {}
+PixelStrip::Segment::Segment(PixelStrip &p, uint16_t s, uint16_t e, const char *n, uint8_t i,
+                             uint16_t offset, uint16_t length)
+    : parent(p), startIdx(s), endIdx(e), layerOffset(offset), layerLength(length), id(i), brightness(255), z(i)
+{
+    strncpy(name, n, sizeof(name));
+    name[sizeof(name) - 1] = '\0';
+}
 
 // --- REQUIRED: Implementations for missing functions ---
 uint16_t PixelStrip::Segment::startIndex() const { return startIdx; }
 uint16_t PixelStrip::Segment::endIndex() const { return endIdx; }
-String PixelStrip::Segment::getName() const { return name; }
+const char *PixelStrip::Segment::getName() const { return name; }
 uint8_t PixelStrip::Segment::getId() const { return id; }
 
 void PixelStrip::Segment::begin() { clear(); }
-void PixelStrip::Segment::setBrightness(uint8_t b) { brightness = b; }
+void PixelStrip::Segment::setBrightness(uint8_t b)
+{
+    if (b != brightness)
+    {
+        brightness = b;
+        parent.layersDirty_ = true; // Applied with the gain when compositing
+    }
+}
 uint8_t PixelStrip::Segment::getBrightness() const { return brightness; }
 
+void PixelStrip::Segment::setLayer(uint8_t layer)
+{
+    z = layer;
+    parent.layoutDirty_ = true;
+}
+
+void PixelStrip::Segment::setBlend(Raster::BlendMode mode, uint8_t alpha)
+{
+    blendMode = mode;
+    opacity = alpha;
+    parent.layoutDirty_ = true;
+}
+
+void PixelStrip::Segment::setGain(uint8_t g)
+{
+    if (g != gain)
+    {
+        gain = g;
+        parent.layersDirty_ = true; // Applied when compositing, so twins still share frames
+    }
+}
+
+// The modifiers change how much of the layer the effect draws; the old frame is cleared.
+// Effects that precompute per-pixel tables do so in start(), so restart them afterwards.
+void PixelStrip::Segment::setMirror(bool on)
+{
+    mirrored = on;
+    parent.layoutDirty_ = true;
+    allOff();
+}
+
+void PixelStrip::Segment::setRepeat(uint8_t count)
+{
+    repeat = count ? count : 1;
+    parent.layoutDirty_ = true;
+    allOff();
+}
+
+void PixelStrip::Segment::setGroup(uint8_t size)
+{
+    group = size ? size : 1;
+    parent.layoutDirty_ = true;
+    allOff();
+}
+
+// Seed for the effect's generator from the next startEffect() on; equal seeds replay equal frames
+void PixelStrip::Segment::setSeed(uint32_t s)
+{
+    seed = s;
+    parent.layoutDirty_ = true; // Part of what makes two segments render alike
+}
+
+void PixelStrip::Segment::setPalette(uint8_t slot)
+{
+    paletteSlot = PaletteBank::NONE;
+    if (slot < PALETTE_SLOTS)
+    {
+        paletteSlot = slot;
+    }
+    parent.layoutDirty_ = true;
+}
+
+// Call after editing the running effect's state directly (e.g. setripplewidth): the
+// segment then renders on its own until its effect is started again
+void PixelStrip::Segment::paramsChanged()
+{
+    customized = true;
+    parent.layoutDirty_ = true;
+}
+
+// True if both segments are visible and would render identical frames
+bool PixelStrip::Segment::rendersLike(const Segment &o) const
+{
+    return active && o.active && !occluded && !o.occluded && !customized && !o.customized && layerLength > 0 &&
+           activeEffect == o.activeEffect && paramSig == o.paramSig &&
+           layerLength == o.layerLength && gridW == o.gridW && gridH == o.gridH && mirrored == o.mirrored &&
+           repeat == o.repeat && group == o.group && seed == o.seed &&
+           paletteSlot == o.paletteSlot;
+}
+
+// Take src's frame instead of rendering, rotated left by this segment's phase
+void PixelStrip::Segment::copyFrame(Segment &src)
+{
+    PixelSpan dst = pixels();
+    PixelSpan from = src.pixels();
+    uint16_t n = dst.size();
+    uint16_t p = phase % n;
+    Raster::blit(dst, from.subSpan(p, n - p));
+    Raster::blit(dst.subSpan(n - p, p), from);
+    parent.layersDirty_ = true;
+}
+
 void PixelStrip::Segment::allOff()
 {
-    for (uint16_t i = startIndex(); i <= endIndex(); ++i)
+    pixels().clear();
+    parent.layersDirty_ = true;
+}
+
+// This segment's layer buffer (the part of the segment that lies on the bus)
+PixelSpan PixelStrip::Segment::pixels()
+{
+    return PixelSpan(parent.layerArena_ + (size_t)layerOffset * PixelFeature::PixelSize, layerLength);
+}
+
+// Lay the layer out as a width x height grid, row by row; 0 x 0 makes it a plain strip again.
+// Effects that precompute per-cell tables do so in start(), so set the grid before starting one.
+bool PixelStrip::Segment::setGrid(uint16_t width, uint16_t height)
+{
+    if ((uint32_t)width * height > layerLength || (width == 0) != (height == 0))
     {
-        parent.getStrip().SetPixelColor(i, RgbColor(0));
+        return false;
     }
+    gridW = width;
+    gridH = height;
+    parent.layoutDirty_ = true;
+    return true;
+}
+
+// The start of the layer that the effect draws into: the layer divided by the mirror,
+// repeat and group modifiers (rounded up). render() replicates it over the rest.
+PixelSpan PixelStrip::Segment::renderPixels()
+{
+    uint16_t n = mirrored ? (layerLength + 1) / 2 : layerLength;
+    n = (n + repeat - 1) / repeat;
+    n = (n + group - 1) / group;
+    return pixels().subSpan(0, n);
 }
 
 void PixelStrip::Segment::setEffect(SegmentEffect effect)
 {
+    parent.layoutDirty_ = true; // Opacity depends on 'active'
     active = false;
     clear();
     activeEffect = effect;
@@ -124,62 +754,216 @@ void PixelStrip::Segment::setTriggerState(bool isActive, uint8_t brightness)
     triggerBrightness = brightness;
 }
 
-void PixelStrip::Segment::startEffect(SegmentEffect effect, uint32_t color1, uint32_t color2)
+void PixelStrip::Segment::startEffect(SegmentEffect effect)
+{
+    setEffect(effect); // Stops and clears the segment
+    paramSig = 0;
+    customized = false;
+    prng.seed(seed);
+    interval = 0;
+    lastUpdate = 0;
+    if (effect >= SegmentEffect::EFFECT_COUNT)
+    {
+        activeEffect = SegmentEffect::NONE;
+        return;
+    }
+    const EffectOps &ops = EFFECT_OPS[static_cast<uint8_t>(effect)];
+    if (ops.start)
+    {
+        active = true;
+        ops.start(*this);
+    }
+}
+
+ParamList PixelStrip::Segment::params() const
+{
+    const EffectOps &ops = EFFECT_OPS[static_cast<uint8_t>(activeEffect)];
+    return active && ops.params ? ops.params() : ParamList();
+}
+
+int PixelStrip::Segment::findParam(const char *name) const
+{
+    ParamList list = params();
+    for (uint8_t i = 0; i < list.count; ++i)
+    {
+        if (Params::nameIs(list.specs[i].name, name))
+            return i;
+    }
+    return -1;
+}
+
+// Write a validated value into the running effect's state (or the segment's interval /
+// base color). The effect keeps running; the next frame uses the new value.
+bool PixelStrip::Segment::setParam(uint8_t index, int32_t value)
+{
+    ParamList list = params();
+    if (index >= list.count)
+        return false;
+    const ParamSpec &p = list.specs[index];
+    if (value < p.min || value > p.max)
+        return false;
+    writeParam(p, value);
+    // Twins that receive the same settings keep sharing frames
+    paramSig = (paramSig * 31 + index) * 0x9E3779B1UL ^ (uint32_t)value;
+    parent.layoutDirty_ = true;
+    return true;
+}
+
+void PixelStrip::Segment::modulateParam(uint8_t index, int32_t value)
+{
+    ParamList list = params();
+    if (index >= list.count)
+        return;
+    const ParamSpec &p = list.specs[index];
+    writeParam(p, value < p.min ? p.min : value > p.max ? p.max : value);
+    if (!customized)
+        paramsChanged(); // Also after a restart of the routed effect, which clears the flag
+}
+
+void PixelStrip::Segment::writeParam(const ParamSpec &p, int32_t value)
 {
-    setEffect(effect);
-    switch (effect)
+    uint8_t *field = effectState + p.offset;
+    switch (p.type)
     {
-#define EFFECT_START_CASE(name, className)      \
-    case SegmentEffect::name:                   \
-        className::start(this, color1, color2); \
+    case ParamType::U8:
+        *field = (uint8_t)value;
         break;
-        EFFECT_LIST(EFFECT_START_CASE)
-#undef EFFECT_START_CASE
-    case SegmentEffect::NONE:
-    default:
-        clear();
+    case ParamType::U16:
+    {
+        uint16_t v = (uint16_t)value;
+        memcpy(field, &v, sizeof(v));
+        break;
+    }
+    case ParamType::FLOAT:
+    {
+        float v = value / 1000.0f;
+        memcpy(field, &v, sizeof(v));
+        break;
+    }
+    case ParamType::RGB:
+        *reinterpret_cast<RgbColor *>(field) = ColorToRgb(value);
+        break;
+    case ParamType::INTERVAL:
+        interval = value;
+        break;
+    case ParamType::COLOR:
+        baseColor = value;
         break;
     }
 }
 
-void PixelStrip::Segment::update()
+// Apply count records of PARAM_RECORD_BYTES (param index, int32 value little-endian),
+// all or none: nothing is written unless every record is valid
+bool PixelStrip::Segment::setParams(const uint8_t *records, uint8_t count)
 {
-    parent.setActiveBrightness(brightness);
+    ParamList list = params();
+    for (uint8_t pass = 0; pass < 2; ++pass)
+    {
+        for (uint8_t i = 0; i < count; ++i)
+        {
+            const uint8_t *r = records + i * PARAM_RECORD_BYTES;
+            int32_t value = (int32_t)((uint32_t)r[1] | (uint32_t)r[2] << 8 | (uint32_t)r[3] << 16 | (uint32_t)r[4] << 24);
+            if (pass == 1)
+            {
+                setParam(r[0], value);
+            }
+            else if (r[0] >= list.count || value < list.specs[r[0]].min || value > list.specs[r[0]].max)
+            {
+                return false;
+            }
+        }
+    }
+    return true;
+}
 
-    switch (activeEffect)
+int32_t PixelStrip::Segment::getParam(uint8_t index) const
+{
+    ParamList list = params();
+    if (index >= list.count)
+        return 0;
+    const ParamSpec &p = list.specs[index];
+    const uint8_t *field = effectState + p.offset;
+    switch (p.type)
     {
-#define EFFECT_UPDATE_CASE(name, className) \
-    case SegmentEffect::name:               \
-        className::update(this);            \
-        break;
-        EFFECT_LIST(EFFECT_UPDATE_CASE)
-#undef EFFECT_UPDATE_CASE
+    case ParamType::U8:
+        return *field;
+    case ParamType::U16:
+    {
+        uint16_t v;
+        memcpy(&v, field, sizeof(v));
+        return v;
+    }
+    case ParamType::FLOAT:
+    {
+        float v;
+        memcpy(&v, field, sizeof(v));
+        return (int32_t)(v * 1000.0f + (v < 0 ? -0.5f : 0.5f));
+    }
+    case ParamType::RGB:
+    {
+        const RgbColor &c = *reinterpret_cast<const RgbColor *>(field);
+        return (int32_t)c.R << 16 | (int32_t)c.G << 8 | c.B;
+    }
+    case ParamType::INTERVAL:
+        return (int32_t)interval;
+    case ParamType::COLOR:
+        return (int32_t)baseColor;
+    }
+    return 0;
+}
 
-    case SegmentEffect::NONE:
-    default:
-        break;
+// Render a frame once the effect's interval has elapsed; true if it did
+bool PixelStrip::Segment::update()
+{
+    if (!active || occluded)
+        return false;
+    unsigned long now = millis();
+    if (now - lastUpdate < interval)
+        return false;
+    lastUpdate = now;
+    render();
+    return true;
+}
+
+// Render one frame immediately, ignoring the interval
+void PixelStrip::Segment::render()
+{
+    const EffectOps &ops = EFFECT_OPS[static_cast<uint8_t>(activeEffect)];
+    if (!active || !ops.render)
+        return;
+    PROFILE_SCOPE(Profiler::effectSite(static_cast<uint8_t>(activeEffect)), Profiler::segmentSite(id));
+    PixelSpan px = pixels();
+    PixelSpan drawn = renderPixels();
+    ops.render(*this, drawn);
+    if (drawn.size() < px.size())
+    {
+        // Undo the modifiers innermost first: group, then repeat, then mirror
+        uint16_t half = mirrored ? (px.size() + 1) / 2 : px.size();
+        uint16_t tile = (half + repeat - 1) / repeat;
+        if (group > 1)
+            Raster::spread(px.subSpan(0, tile), drawn.size(), group);
+        if (repeat > 1)
+            Raster::tile(px.subSpan(0, half), tile);
+        if (mirrored)
+            Raster::mirror(px, half);
     }
+    parent.layersDirty_ = true;
 }
 
-// In PixelStrip.cpp
 void PixelStrip::clearUserSegments() {
     // We start at index 1 to preserve the default "all" segment at index 0
-    if (segments_.size() <= 1) return;
-
-    for (size_t i = 1; i < segments_.size(); ++i) {
-        delete segments_[i]; // Free the memory for each segment
+    for (uint8_t i = 1; i < segmentCount_; ++i) {
+        segmentAt(i)->~Segment(); // Slots are reused by the next addSection()
     }
-    segments_.resize(1); // Shrink the vector back to only contain the "all" segment
+    if (segmentCount_ > 1) segmentCount_ = 1;
+    layerPixelsUsed_ = segmentCount_ ? segmentAt(0)->layerLength : 0;
+    layoutDirty_ = true;
 }
 
 void PixelStrip::propagateTriggerState(bool isActive, uint8_t brightness)
 {
-    // Loop through all segments
-    for (auto* s : segments_) {
-        // If a segment is running a trigger effect, update its state.
-        // This can be expanded with || for other future trigger effects.
-        if (s->activeEffect == Segment::SegmentEffect::FLASH_TRIGGER) {
-            s->setTriggerState(isActive, brightness);
-        }
+    // Every segment gets the trigger state; effects that do not react to it ignore it
+    for (auto* s : getSegments()) {
+        s->setTriggerState(isActive, brightness);
     }
 }
\ No newline at end of file
@@ -3,11 +3,86 @@
 
 #include <Arduino.h>
 #include <NeoPixelBus.h>
-#include <vector>
+#include "PixelSpan.h"
+#include "PixelGrid.h"
+#include "Raster.h"
+#include "PowerLimiter.h"
+#include "PixelMap.h"
+#include "FastRandom.h"
+#include "Palette.h"
+#include "EffectParams.h"
 #include "effects/Effects.h"
 
-using PixelBus = NeoPixelBus<NeoGrbFeature, Neo800KbpsMethod>;
+// LED chipset, chosen at build time: the NeoPixelBus color feature (wire byte order, e.g.
+// NeoGrbwFeature for SK6812 RGBW, DotStarBgrFeature for APA102) and output method
+#ifndef PIXELSTRIP_FEATURE
+#define PIXELSTRIP_FEATURE NeoGrbFeature
+#endif
+#ifndef PIXELSTRIP_METHOD
+#define PIXELSTRIP_METHOD Neo800KbpsMethod
+#endif
+// Define for two-wire chipsets (e.g. APA102 with DotStarMethod); the strip's pin is then the data pin
+// and each OutputConfig's clockPin is used (this value is the clock of the single-pin constructor)
+// #define PIXELSTRIP_CLOCK_PIN 2
+// Physical outputs one strip can drive. Each is its own bus (on the RP2040 its own PIO state
+// machine and DMA channel), so they send in parallel.
+#ifndef PIXELSTRIP_MAX_OUTPUTS
+#define PIXELSTRIP_MAX_OUTPUTS 4
+#endif
 
+using WireFeature = PIXELSTRIP_FEATURE;
+using PixelBus = NeoPixelBus<WireFeature, PIXELSTRIP_METHOD>;
+// Effects and layers always render canonical RGB; only the output pass knows the wire format
+using PixelFeature = NeoRgbFeature;
+using PixelSpan = BasicPixelSpan<PixelFeature>;
+using PixelGrid = BasicPixelGrid<PixelFeature>;
+using WireChannels = Raster::WireColor<WireFeature::ColorObject>;
+
+// Segments live in a fixed pool inside PixelStrip; adding/clearing them never touches the heap.
+#ifndef PIXELSTRIP_MAX_SEGMENTS
+#define PIXELSTRIP_MAX_SEGMENTS 32
+#endif
+// Every segment renders into its own slice of a fixed layer arena, sized in pixels. It must
+// hold at least segment 0, i.e. the LEDs of all outputs together.
+#ifndef PIXELSTRIP_LAYER_PIXELS
+#define PIXELSTRIP_LAYER_PIXELS 2048
+#endif
+// 1 = composite in 16 bits per channel and dither down to the bus every frame (costs 2 bytes
+// per color and 1 per wire channel of heap); 0 = composite straight into the bus buffer, for boards short on RAM
+#ifndef PIXELSTRIP_HIGH_PRECISION
+#define PIXELSTRIP_HIGH_PRECISION 1
+#endif
+// Segment names are stored inline, truncated to this length (including the terminator)
+static const uint8_t SEGMENT_NAME_LEN = 12;
+// Size of the per-segment effect state block; must equal the largest Effect::State (checked in PixelStrip.cpp)
+static const uint8_t EFFECT_STATE_BYTES = 16;
+
+/**
+ * Segments are layers. Each one renders into its own buffer in the layer arena; show()
+ * composites the visible layers into the bus in z order (ties broken by index), blending
+ * each with its BlendMode. An active REPLACE layer is opaque: segments it fully covers
+ * are neither rendered nor composited. Inactive segments are transparent.
+ *
+ * Pixel indices are logical: the outputs are laid end to end, so output 1's first LED
+ * follows output 0's last. show() converts and starts each output in turn without
+ * waiting for the wire, so a frame takes as long as the longest chain.
+ *
+ * An optional PixelMap remaps logical pixels to physical LEDs in the same output pass.
+ * A segment can also be declared a width x height grid for the 2D effects (see PixelGrid.h).
+ *
+ * Mirror, repeat and group modifiers let an effect render only the start of its layer
+ * (renderPixels()); render() then replicates it over the rest with block copies, so the
+ * effect's cost shrinks by the same factor as its span.
+ *
+ * Segments that run the same effect, started with the same arguments, on layers of the
+ * same length and shape, render the same frames. The lowest one in z order renders; the
+ * others copy its layer (rotated by their phase) instead of running the effect.
+ *
+ * Each segment's brightness and gain scale its layer as it is composited; the output
+ * brightness (0 = black) and the power budget scale the composited frame once. With
+ * PIXELSTRIP_HIGH_PRECISION the frame is kept in 8.8 fixed point and dithered to 8 bits
+ * on every show(), so dim levels average out over frames instead of posterizing.
+ */
 class PixelStrip
 {
 public:
@@ -17,7 +92,7 @@ public:
     class Segment
     {
     public:
-        enum class SegmentEffect
+        enum class SegmentEffect : uint8_t
         {
             NONE,
 #define EFFECT_ENUM_ENTRY(name, className) name,
@@ -26,81 +101,266 @@ public:
                 EFFECT_COUNT
         };
 
-        Segment(PixelStrip &parent, uint16_t startIdx, uint16_t endIdx, const String &name, uint8_t id);
+        Segment(PixelStrip &parent, uint16_t startIdx, uint16_t endIdx, const char *name, uint8_t id,
+                uint16_t layerOffset, uint16_t layerLength);
 
         uint16_t startIndex() const;
         uint16_t endIndex() const;
-        String getName() const;
+        const char *getName() const;
         uint8_t getId() const;
         SegmentEffect activeEffect = SegmentEffect::NONE;
 
         void begin();
-        void update();
+        bool update();
+        void render();
+        PixelSpan pixels();
+        PixelSpan renderPixels();
+        bool setGrid(uint16_t width, uint16_t height);
+        uint16_t gridWidth() const { return gridW; }
+        uint16_t gridHeight() const { return gridH; }
+        PixelGrid grid() { return PixelGrid(renderPixels(), gridW, gridH); }
         void allOff();
         inline void clear() { allOff(); }
 
         void setEffect(SegmentEffect effect);
-        void startEffect(SegmentEffect effect, uint32_t color1 = 0, uint32_t color2 = 0);
+        void startEffect(SegmentEffect effect);
+
+        /// Schema of the running effect's parameters (empty when stopped)
+        ParamList params() const;
+        /// Index of the named parameter in params(), or -1
+        int findParam(const char *name) const;
+        bool setParam(uint8_t index, int32_t value);
+        bool setParams(const uint8_t *records, uint8_t count);
+        /// Per-frame write from the modulation matrix: clamped to the range; the segment stops sharing frames
+        void modulateParam(uint8_t index, int32_t value);
+        int32_t getParam(uint8_t index) const;
 
         void setTriggerState(bool isActive, uint8_t brightness);
 
+        /// Dims the layer as it is composited (255 = as drawn), so the 16-bit path keeps the fraction
         void setBrightness(uint8_t b);
         uint8_t getBrightness() const;
 
+        void setLayer(uint8_t z);
+        uint8_t getLayer() const { return z; }
+        void setMirror(bool on);
+        void setRepeat(uint8_t count);
+        void setGroup(uint8_t size);
+        bool isMirrored() const { return mirrored; }
+        uint8_t getRepeat() const { return repeat; }
+        uint8_t getGroup() const { return group; }
+        /// This segment's generator for effects; reseeded from getSeed() by startEffect()
+        FastRandom &rng() { return prng; }
+        void setSeed(uint32_t s);
+        uint32_t getSeed() const { return seed; }
+        void setPalette(uint8_t slot);
+        /// Selected palette slot, or PaletteBank::NONE for the effect's own
+        uint8_t getPalette() const { return paletteSlot; }
+        /// 256-entry table of the selected palette, or of builtin if none is selected
+        const RgbColor *palette(uint8_t builtin) const
+        {
+            return parent.palettes_.table(paletteSlot == PaletteBank::NONE ? builtin : paletteSlot);
+        }
+        void setPhase(uint16_t offset) { phase = offset; }
+        uint16_t getPhase() const { return phase; }
+        void paramsChanged();
+        /// Id of the segment whose frame this one copies instead of rendering, or -1
+        int copiesFrom() const { return shareFrom == NO_SHARE ? -1 : shareFrom; }
+        void setBlend(Raster::BlendMode mode, uint8_t opacity = 255);
+        Raster::BlendMode getBlendMode() const { return blendMode; }
+        uint8_t getOpacity() const { return opacity; }
+        /// Scale of the layer as it is composited, on top of the brightness (255 = as rendered);
+        /// brightness routes drive it
+        void setGain(uint8_t g);
+        uint8_t getGain() const { return gain; }
+        bool isOpaque() const { return active && blendMode == Raster::BlendMode::REPLACE; }
+        bool isOccluded() const { return occluded; }
+
         PixelStrip &getParent() { return parent; }
 
+        /**
+         * @brief The running effect's own state. Each EFFECT_LIST entry declares a `State`
+         *        struct; startEffect() value-initializes it in this segment's state block
+         *        and passes it to the effect's start() and render().
+         */
+        template <typename T>
+        T &state()
+        {
+            static_assert(sizeof(T) <= EFFECT_STATE_BYTES, "Effect State too large; raise EFFECT_STATE_BYTES");
+            return *reinterpret_cast<T *>(effectState);
+        }
+
         // --- UNIFIED STATE VARIABLES ---
         bool active = false;
-        uint32_t baseColor = 0;
-        unsigned long lastUpdate = 0;
-        unsigned long interval = 0;
 
         // State for Trigger-based effects
         bool triggerIsActive = false;
         uint8_t triggerBrightness = 0;
 
-        // --- State unique to specific effects ---
-        unsigned long rainbowFirstPixelHue = 0;
-        uint8_t chaseOffset = 0;
-
-        // Configurable parameters for the Fire effect
-        uint8_t fireSparking = 120;
-        uint8_t fireCooling = 55;
-
-        // Configurable parameters for the colored fire effect
-        uint32_t fireColor1 = 0x000000;
-        uint32_t fireColor2 = 0xFF0000;
-        uint32_t fireColor3 = 0xFFFF00;
-
-        // --- ADDED: Configurable parameters for the Kinetic Ripple effect ---
-        int rippleWidth = 3;      // The width of the ripple in pixels
-        float rippleSpeed = 0.2f; // The speed/fade duration of the ripple
+        uint32_t baseColor = 0;
+        unsigned long lastUpdate = 0;
+        unsigned long interval = 0;
 
     private:
+        static const uint8_t NO_SHARE = 0xFF;
+        static const uint32_t DEFAULT_SEED = 0x2545F491UL;
+        bool rendersLike(const Segment &o) const;
+        void writeParam(const ParamSpec &p, int32_t value);
+        void copyFrame(Segment &src);
+
+        alignas(4) uint8_t effectState[EFFECT_STATE_BYTES];
+        uint32_t paramSig = 0;             // Hash of the setParam() calls since the last startEffect()
+        uint32_t seed = DEFAULT_SEED;      // Same for every segment by default, so twins can share frames
+        FastRandom prng;
         PixelStrip &parent;
         uint16_t startIdx, endIdx;
-        String name;
+        uint16_t layerOffset, layerLength; // This segment's pixels in the layer arena
+        uint16_t gridW = 0, gridH = 0;     // 2D layout of the layer (0 = a plain strip)
+        bool mirrored = false;             // Second half is the first half reversed
+        uint8_t repeat = 1;                // The (first half of the) layer is this many copies of a tile
+        uint8_t group = 1;                 // Each rendered pixel covers this many pixels of a tile
+        uint8_t paletteSlot = PaletteBank::NONE; // Palette the effect colors with
+        uint16_t phase = 0;                // Rotation of a copied frame, in pixels
+        uint8_t shareFrom = NO_SHARE;      // Segment rendering the same frame lower in z order
+        bool customized = false;           // State was edited after start, so it may differ from a twin's
+        bool fresh = false;                // Rendered or copied in this update() pass
+        char name[SEGMENT_NAME_LEN];
         uint8_t id;
         uint8_t brightness;
+        uint8_t z;
+        Raster::BlendMode blendMode = Raster::BlendMode::REPLACE;
+        uint8_t opacity = 255;
+        uint8_t gain = 255;
+        bool occluded = false;
+
+        friend class PixelStrip;
     };
 
+    /**
+     * @brief Lightweight view over the contiguous segment pool; iterates as Segment pointers.
+     */
+    class SegmentList
+    {
+    public:
+        class iterator
+        {
+        public:
+            explicit iterator(Segment *p) : p_(p) {}
+            Segment *operator*() const { return p_; }
+            iterator &operator++()
+            {
+                ++p_;
+                return *this;
+            }
+            bool operator!=(const iterator &o) const { return p_ != o.p_; }
+
+        private:
+            Segment *p_;
+        };
+
+        SegmentList(Segment *first, size_t count) : first_(first), count_(count) {}
+        iterator begin() const { return iterator(first_); }
+        iterator end() const { return iterator(first_ + count_); }
+        size_t size() const { return count_; }
+        Segment *operator[](size_t i) const { return first_ + i; }
+
+    private:
+        Segment *first_;
+        size_t count_;
+    };
+
+    /// One physical LED chain
+    struct OutputConfig
+    {
+        uint8_t pin;
+        uint16_t ledCount;
+        uint8_t clockPin; // Two-wire chipsets only (PIXELSTRIP_CLOCK_PIN defined)
+    };
+
+    /// LEDs of count outputs together, so a constexpr output list can be checked against
+    /// PIXELSTRIP_LAYER_PIXELS at compile time
+    static constexpr uint32_t totalLeds(const OutputConfig *outputs, size_t count)
+    {
+        return count ? outputs->ledCount + totalLeds(outputs + 1, count - 1) : 0;
+    }
+
     PixelStrip(uint8_t pin, uint16_t ledCount, uint8_t brightness = 50, uint8_t numSections = 0);
+    PixelStrip(const OutputConfig *outputs, uint8_t outputCount, uint8_t brightness = 50, uint8_t numSections = 0);
+    ~PixelStrip();
     void begin();
-    void show();
+    /// Render the segments that are due; true if any rendered or copied a frame
+    bool update();
+    bool show();
     void clear();
     uint32_t Color(uint8_t r, uint8_t g, uint8_t b);
     uint32_t ColorHSV(uint16_t hue, uint8_t sat = 255, uint8_t val = 255);
+    static inline RgbColor ColorToRgb(uint32_t c)
+    {
+        return RgbColor((c >> 16) & 0xFF, (c >> 8) & 0xFF, c & 0xFF);
+    }
     void setPixel(uint16_t idx, uint32_t color);
     void clearPixel(uint16_t idx);
     void setActiveBrightness(uint8_t b);
-    const std::vector<Segment *> &getSegments() const;
+    SegmentList getSegments() const;
     PixelBus &getStrip();
-    void addSection(uint16_t start, uint16_t end, const String &name);
+    uint8_t outputCount() const { return outputCount_; }
+    PixelBus &getOutput(uint8_t i) { return *outputAt(i); }
+    uint16_t pixelCount() const { return pixelCount_; }
+    /// LEDs of the configured outputs left out because they exceed PIXELSTRIP_LAYER_PIXELS (0 normally)
+    uint16_t droppedPixels() const { return droppedPixels_; }
+    void printOutputs(Print &out) const;
+    bool addSection(uint16_t start, uint16_t end, const char *name);
+    /// Add a segment with a layer of length pixels past the last LED, rendered but never shown,
+    /// so effects can be timed at sizes the outputs don't have; nullptr if it does not fit
+    Segment *addOffscreenSection(uint16_t length, const char *name);
+    /// Remove the most recently added segment, keeping segment 0
+    void removeLastSection();
+    PowerLimiter &power() { return power_; }
+    PixelMap &pixelMap() { return pixelMap_; }
+    PaletteBank &palettes() { return palettes_; }
+    /// Logical pixel of cell (x, y) of the mapped matrix (PixelMap::NONE outside it)
+    uint16_t XY(uint16_t x, uint16_t y) const { return pixelMap_.XY(x, y); }
+    void setOutputBrightness(uint8_t b);
+    uint8_t getOutputBrightness() const { return outputBrightness_; }
+    void printMemoryUsage(Print &out) const;
+    void printSharing(Print &out) const;
 
 private:
-    PixelBus strip;
-    std::vector<Segment *> segments_;
+    Segment *segmentAt(uint8_t i) const { return reinterpret_cast<Segment *>(const_cast<uint8_t *>(segmentPool_)) + i; }
+    PixelBus *outputAt(uint8_t i) const { return reinterpret_cast<PixelBus *>(const_cast<uint8_t *>(outputPool_)) + i; }
+    PixelBus *outputFor(uint16_t &idx) const;
+    void init(const OutputConfig *outputs, uint8_t outputCount, uint8_t brightness, uint8_t numSections);
+    void relayout();
+    void composite();
+
+    alignas(PixelBus) uint8_t outputPool_[PIXELSTRIP_MAX_OUTPUTS * sizeof(PixelBus)];
+    uint16_t outputStart_[PIXELSTRIP_MAX_OUTPUTS]; // First logical pixel of each output
+    uint8_t outputPin_[PIXELSTRIP_MAX_OUTPUTS];
+    uint8_t outputCount_ = 0;
+    uint16_t pixelCount_ = 0; // Logical pixels across all outputs
+    uint16_t droppedPixels_ = 0; // Configured LEDs that did not fit the layer arena
+    PowerLimiter power_;
+    PixelMap pixelMap_;
+    PaletteBank palettes_;
+    alignas(Segment) uint8_t segmentPool_[PIXELSTRIP_MAX_SEGMENTS * sizeof(Segment)];
+    alignas(4) uint8_t layerArena_[PIXELSTRIP_LAYER_PIXELS * PixelFeature::PixelSize];
+#if PIXELSTRIP_HIGH_PRECISION
+    uint16_t *wide_;    // Composited frame, canonical RGB in 8.8 fixed point
+    uint8_t *residual_; // Dither remainder of each wire channel, carried to the next frame
+#else
+    uint8_t *frame_ = nullptr; // Composited canonical frame for several outputs or a pixel map (else output 0's buffer)
+#endif
+    uint32_t outputScale_ = Raster::SCALE_ONE; // Brightness and power scale of the composited frame
+    uint8_t layerOrder_[PIXELSTRIP_MAX_SEGMENTS]; // Segment indices, bottom layer first
+    uint16_t layerPixelsUsed_ = 0;
+    uint8_t segmentCount_ = 0;
     uint8_t activeBrightness_ = 128;
+    uint8_t outputBrightness_ = 255;
+    uint16_t sharedThisSecond_ = 0; // Renders replaced by a copy in the current one-second window
+    uint16_t sharedPerSecond_ = 0;  // ... and in the last complete one
+    unsigned long shareWindowStart_ = 0;
+    bool layoutDirty_ = true;  // z order / coverage must be recomputed
+    bool layersDirty_ = false; // a layer changed since the last composite
 };
 
 #endif // PIXELSTRIP_H
\ No newline at end of file
@@ -0,0 +1,198 @@
+// File: PowerLimiter.h
+#ifndef POWER_LIMITER_H
+#define POWER_LIMITER_H
+
+#include <Arduino.h>
+#include <NeoPixelBus.h>
+
+/**
+ * @file PowerLimiter.h
+ * @brief Estimated LED current and an optional global current budget.
+ *
+ * The compositor keeps one running sum per wire position (G, R, B for a GRB strip), in
+ * 8.8 fixed point, while it writes the output buffer: it zeroes them when it clears the
+ * buffer and adds each blend's (new - old) delta, so the sums are exact without a
+ * separate scan. The estimate is idle current per LED plus each channel's full-on
+ * current scaled by its sum. The output brightness scales the LED part of it; only when
+ * that still exceeds the budget is the scale lowered to (budget - idle) / (estimate - idle).
+ * The compositor applies the resulting scale to the whole output once.
+ */
+
+/// Full-on current of one color channel of one LED, in mA
+#ifndef POWER_CHANNEL_MA
+#define POWER_CHANNEL_MA 20
+#endif
+/// Current of one LED that is fully off, in mA
+#ifndef POWER_IDLE_MA
+#define POWER_IDLE_MA 1
+#endif
+
+/// Most bytes per pixel of any supported color feature
+static const uint8_t POWER_MAX_CHANNELS = 4;
+
+/**
+ * @class PowerLimiter
+ * @brief Current estimate, budget and statistics for the composited output.
+ */
+class PowerLimiter
+{
+public:
+    PowerLimiter() : _budgetMa(0), _limited(false), _changed(false)
+    {
+        memset(_sums, 0, sizeof(_sums));
+        memset(_byteMa, 0, sizeof(_byteMa));
+        resetStats();
+    }
+
+    /**
+     * @brief Derive the per-byte channel currents from the bus color feature.
+     */
+    template <typename F>
+    void setChannelCurrents(uint8_t redMa, uint8_t greenMa, uint8_t blueMa)
+    {
+        static_assert(F::PixelSize <= POWER_MAX_CHANNELS, "Too many bytes per pixel");
+        uint8_t r[F::PixelSize] = {}, g[F::PixelSize] = {}, b[F::PixelSize] = {};
+        F::applyPixelColor(r, 0, typename F::ColorObject(RgbColor(255, 0, 0)));
+        F::applyPixelColor(g, 0, typename F::ColorObject(RgbColor(0, 255, 0)));
+        F::applyPixelColor(b, 0, typename F::ColorObject(RgbColor(0, 0, 255)));
+        for (uint8_t k = 0; k < F::PixelSize; ++k)
+        {
+            _byteMa[k] = r[k] ? redMa : g[k] ? greenMa : b[k] ? blueMa : 0;
+        }
+    }
+
+    /// Running sums of the output buffer in 8.8 fixed point, one per wire position
+    inline int32_t *sums() { return _sums; }
+
+    /// Output buffer was cleared
+    inline void clearSums() { memset(_sums, 0, sizeof(_sums)); }
+
+    /**
+     * @brief Estimated current of the buffer described by sums(), in mA.
+     */
+    uint32_t estimateMa(uint16_t pixelCount) const
+    {
+        uint32_t ma = (uint32_t)pixelCount * POWER_IDLE_MA;
+        for (uint8_t k = 0; k < POWER_MAX_CHANNELS; ++k)
+        {
+            ma += (uint32_t)(((uint64_t)_sums[k] * _byteMa[k] + 0x7F80) / 0xFF00);
+        }
+        return ma;
+    }
+
+    /**
+     * @brief Record the estimate of a freshly composited buffer and pick its output scale.
+     * @param brightness Output brightness (255 = as composited, 0 = black), applied before the budget.
+     * @return Scale to apply in 1/65536 (65536 = leave the frame as it is).
+     */
+    uint32_t limit(uint16_t pixelCount, uint8_t brightness = 255)
+    {
+        _changed = false;
+        _rawMa = estimateMa(pixelCount);
+        _scale = brightness ? ((uint32_t)brightness + 1) << 8 : 0; // 0 = black, not 1/256
+        _limited = false;
+        uint32_t idleMa = (uint32_t)pixelCount * POWER_IDLE_MA;
+        uint32_t ledMa = _rawMa > idleMa ? _rawMa - idleMa : 0;
+        _outMa = idleMa + (uint32_t)(((uint64_t)ledMa * _scale) >> 16);
+        if (_budgetMa && _outMa > _budgetMa && ledMa)
+        {
+            uint32_t usable = _budgetMa > idleMa ? _budgetMa - idleMa : 0;
+            uint32_t scale = (uint32_t)(((uint64_t)usable << 16) / ledMa);
+            _scale = scale < 1 ? 1 : scale;
+            _limited = true;
+            _outMa = idleMa + (uint32_t)(((uint64_t)ledMa * _scale) >> 16);
+        }
+        return _scale;
+    }
+
+    /**
+     * @brief Count one frame sent to the LEDs at the current estimate.
+     */
+    inline void noteFrame()
+    {
+        ++_frames;
+        _totalMa += _outMa;
+        if (_outMa > _peakMa)
+            _peakMa = _outMa;
+        if (_limited)
+            ++_limitedFrames;
+    }
+
+    /// Budget in mA, 0 = unlimited
+    void setBudget(uint32_t ma)
+    {
+        _budgetMa = ma;
+        _changed = true;
+    }
+    uint32_t budget() const { return _budgetMa; }
+
+    /// True after setBudget() until the next limit(), so the output gets recomposited
+    bool changed() const { return _changed; }
+
+    void resetStats()
+    {
+        _rawMa = _outMa = _peakMa = 0;
+        _totalMa = 0;
+        _frames = _limitedFrames = 0;
+        _scale = 0x10000;
+        _limited = false;
+    }
+
+    /**
+     * @brief Print the latest estimate and the window statistics.
+     */
+    void report(Print &out) const
+    {
+        char line[192];
+        snprintf(line, sizeof(line),
+                 "Power: %lu mA (full brightness %lu mA, scale %lu.%lu%%) | budget %s%lu mA | avg %lu mA, peak %lu mA, %lu of %lu frames limited",
+                 (unsigned long)_outMa, (unsigned long)_rawMa, (unsigned long)(_scale * 100 >> 16),
+                 (unsigned long)((_scale * 1000 >> 16) % 10), _budgetMa ? "" : "off ",
+                 (unsigned long)_budgetMa, (unsigned long)(_frames ? _totalMa / _frames : 0),
+                 (unsigned long)_peakMa, (unsigned long)_limitedFrames, (unsigned long)_frames);
+        out.println(line);
+    }
+
+    /**
+     * @brief Handle the parameters of a `power` serial command.
+     * @param params "" prints the estimate; "<mA>" sets the budget (0 = off); "reset" clears the stats.
+     */
+    void handleCommand(const String &params)
+    {
+        if (params.length() == 0)
+        {
+            report(Serial);
+        }
+        else if (params.equalsIgnoreCase("reset"))
+        {
+            resetStats();
+            Serial.println("Power statistics reset.");
+        }
+        else if (isdigit(params.charAt(0)))
+        {
+            setBudget((uint32_t)params.toInt());
+            Serial.print("Power budget: ");
+            Serial.println(_budgetMa ? String(_budgetMa) + " mA" : String("off"));
+        }
+        else
+        {
+            Serial.println("Invalid format. Use: power [<mA>|reset]");
+        }
+    }
+
+private:
+    int32_t _sums[POWER_MAX_CHANNELS];
+    uint8_t _byteMa[POWER_MAX_CHANNELS];
+    uint32_t _budgetMa;
+    uint32_t _rawMa;
+    uint32_t _outMa;
+    uint32_t _peakMa;
+    uint64_t _totalMa;
+    uint32_t _frames;
+    uint32_t _limitedFrames;
+    uint32_t _scale;
+    bool _limited;
+    bool _changed;
+};
+
+#endif // POWER_LIMITER_H
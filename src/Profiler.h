@@ -0,0 +1,320 @@
+// File: Profiler.h
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <Arduino.h>
+#include "effects/Effects.h"
+
+#ifndef ARDUINO
+#include <chrono>
+#endif
+
+/**
+ * @file Profiler.h
+ * @brief Singleton frame-time profiler with per-site min/avg/max and log2 histograms.
+ *
+ * Sites are fixed at compile time: a handful of main-loop stages, one per entry in
+ * EFFECT_LIST and one per segment slot. Build with -DPROFILER_ENABLED=0 to compile
+ * every PROFILE_SCOPE out; at runtime `stats off` leaves only a flag test per scope.
+ */
+
+#ifndef PROFILER_ENABLED
+#define PROFILER_ENABLED 1
+#endif
+
+/// Number of segment slots that get their own profiling site
+#ifndef PROFILER_MAX_SEGMENTS
+#define PROFILER_MAX_SEGMENTS 16
+#endif
+
+/// Fixed main-loop sites. Format: X(ENUM_NAME, "report name")
+#define PROFILE_SITE_LIST(X)   \
+    X(SERIAL_CMD, "serial")    \
+    X(FFT, "fft")              \
+    X(IMU, "imu")              \
+    X(MODS, "mods")            \
+    X(COMPOSITE, "composite")  \
+    X(SHOW, "show")
+
+/// Histogram bucket b counts samples in [2^b, 2^(b+1)) microseconds; the last bucket is open-ended
+static const uint8_t PROFILER_HIST_BUCKETS = 16;
+
+/**
+ * @class Profiler
+ * @brief Accumulates timing statistics for fixed instrumentation sites.
+ */
+class Profiler
+{
+public:
+    enum Site : uint8_t
+    {
+#define PROFILE_SITE_ENUM(name, label) SITE_##name,
+        PROFILE_SITE_LIST(PROFILE_SITE_ENUM)
+#undef PROFILE_SITE_ENUM
+            SITE_FIXED_COUNT
+    };
+
+    /// Number of effects in EFFECT_LIST (excluding NONE)
+    static const uint8_t EFFECT_SITES = 0
+#define PROFILE_COUNT_EFFECT(name, className) +1
+        EFFECT_LIST(PROFILE_COUNT_EFFECT)
+#undef PROFILE_COUNT_EFFECT
+        ;
+
+    static const uint8_t SITE_COUNT = SITE_FIXED_COUNT + EFFECT_SITES + PROFILER_MAX_SEGMENTS;
+    static const uint8_t NO_SITE = 0xFF;
+
+    struct SiteStats
+    {
+        uint32_t count;
+        uint32_t minUs;
+        uint32_t maxUs;
+        uint64_t totalUs;
+        uint32_t hist[PROFILER_HIST_BUCKETS];
+    };
+
+    /**
+     * @brief Get the singleton instance.
+     * @return Reference to Profiler singleton.
+     */
+    static Profiler &instance()
+    {
+        static Profiler inst;
+        return inst;
+    }
+
+    /**
+     * @brief Current timestamp in microseconds (micros() on device, steady_clock on host).
+     */
+    static inline uint32_t now()
+    {
+#ifdef ARDUINO
+        return micros();
+#else
+        using namespace std::chrono;
+        return (uint32_t)duration_cast<microseconds>(steady_clock::now().time_since_epoch()).count();
+#endif
+    }
+
+    /**
+     * @brief Site index for an effect.
+     * @param effectIndex Value of Segment::SegmentEffect (NONE = 0 maps to NO_SITE).
+     */
+    static inline uint8_t effectSite(uint8_t effectIndex)
+    {
+        return (effectIndex == 0 || effectIndex > EFFECT_SITES) ? NO_SITE : SITE_FIXED_COUNT + effectIndex - 1;
+    }
+
+    /**
+     * @brief Site index for a segment id, or NO_SITE if it is beyond PROFILER_MAX_SEGMENTS.
+     */
+    static inline uint8_t segmentSite(uint8_t segmentId)
+    {
+        return (segmentId >= PROFILER_MAX_SEGMENTS) ? NO_SITE : SITE_FIXED_COUNT + EFFECT_SITES + segmentId;
+    }
+
+    bool isEnabled() const { return _enabled; }
+    void setEnabled(bool on) { _enabled = on; }
+
+    /**
+     * @brief Add one sample to a site.
+     * @param site Site index; NO_SITE is ignored.
+     * @param us Elapsed time in microseconds.
+     */
+    inline void record(uint8_t site, uint32_t us)
+    {
+        if (site >= SITE_COUNT)
+            return;
+        SiteStats &s = _stats[site];
+        if (s.count == 0 || us < s.minUs)
+            s.minUs = us;
+        if (us > s.maxUs)
+            s.maxUs = us;
+        s.totalUs += us;
+        ++s.count;
+        ++s.hist[bucketFor(us)];
+    }
+
+    /**
+     * @brief Clear all accumulated statistics.
+     */
+    void reset()
+    {
+        memset(_stats, 0, sizeof(_stats));
+        _resetMs = millis();
+    }
+
+    const SiteStats &stats(uint8_t site) const { return _stats[site]; }
+
+    /**
+     * @brief Write the report name of a site into buf.
+     */
+    void siteName(uint8_t site, char *buf, size_t len) const
+    {
+        static const char *const fixedNames[] = {
+#define PROFILE_SITE_NAME(name, label) label,
+            PROFILE_SITE_LIST(PROFILE_SITE_NAME)
+#undef PROFILE_SITE_NAME
+        };
+        static const char *const effectNames[] = {
+#define PROFILE_EFFECT_NAME(name, className) #className,
+            EFFECT_LIST(PROFILE_EFFECT_NAME)
+#undef PROFILE_EFFECT_NAME
+        };
+        if (site < SITE_FIXED_COUNT)
+            snprintf(buf, len, "%s", fixedNames[site]);
+        else if (site < SITE_FIXED_COUNT + EFFECT_SITES)
+            snprintf(buf, len, "fx:%s", effectNames[site - SITE_FIXED_COUNT]);
+        else
+            snprintf(buf, len, "seg%u", (unsigned)(site - SITE_FIXED_COUNT - EFFECT_SITES));
+    }
+
+    /**
+     * @brief Print a human-readable table of every site that has samples.
+     */
+    void printStats(Print &out) const
+    {
+        char name[24];
+        char line[96];
+        out.print("Profiler stats over ");
+        out.print(millis() - _resetMs);
+        out.println(" ms (times in us)");
+        out.println("  site                  count      min      avg      max");
+        for (uint8_t i = 0; i < SITE_COUNT; ++i)
+        {
+            const SiteStats &s = _stats[i];
+            if (s.count == 0)
+                continue;
+            siteName(i, name, sizeof(name));
+            snprintf(line, sizeof(line), "  %-18s %8lu %8lu %8lu %8lu", name,
+                     (unsigned long)s.count, (unsigned long)s.minUs,
+                     (unsigned long)(s.totalUs / s.count), (unsigned long)s.maxUs);
+            out.println(line);
+        }
+    }
+
+    /**
+     * @brief Print every site with samples as a single JSON line for dashboards.
+     *
+     * Format: {"ms":<window>,"sites":[{"name":..,"n":..,"min":..,"avg":..,"max":..,"hist":[..]},..]}
+     */
+    void printJson(Print &out) const
+    {
+        char name[24];
+        char buf[24];
+        bool first = true;
+        out.print("{\"ms\":");
+        out.print(millis() - _resetMs);
+        out.print(",\"sites\":[");
+        for (uint8_t i = 0; i < SITE_COUNT; ++i)
+        {
+            const SiteStats &s = _stats[i];
+            if (s.count == 0)
+                continue;
+            siteName(i, name, sizeof(name));
+            out.print(first ? "{\"name\":\"" : ",{\"name\":\"");
+            first = false;
+            out.print(name);
+            out.print("\",\"n\":");
+            out.print((unsigned long)s.count);
+            out.print(",\"min\":");
+            out.print((unsigned long)s.minUs);
+            out.print(",\"avg\":");
+            out.print((unsigned long)(s.totalUs / s.count));
+            out.print(",\"max\":");
+            out.print((unsigned long)s.maxUs);
+            out.print(",\"hist\":[");
+            for (uint8_t b = 0; b < PROFILER_HIST_BUCKETS; ++b)
+            {
+                snprintf(buf, sizeof(buf), b ? ",%lu" : "%lu", (unsigned long)s.hist[b]);
+                out.print(buf);
+            }
+            out.print("]}");
+        }
+        out.println("]}");
+    }
+
+    /**
+     * @brief Handle the parameters of a `stats` serial command.
+     * @param params "" | "json" | "reset" | "on" | "off"
+     */
+    void handleCommand(const String &params)
+    {
+        if (params.length() == 0)
+            printStats(Serial);
+        else if (params.equalsIgnoreCase("json"))
+            printJson(Serial);
+        else if (params.equalsIgnoreCase("reset"))
+        {
+            reset();
+            Serial.println("Profiler stats reset.");
+        }
+        else if (params.equalsIgnoreCase("on") || params.equalsIgnoreCase("off"))
+        {
+            setEnabled(params.equalsIgnoreCase("on"));
+            Serial.print("Profiler is now ");
+            Serial.println(_enabled ? "ON" : "OFF");
+        }
+        else
+            Serial.println("Invalid format. Use: stats [json|reset|on|off]");
+    }
+
+private:
+    Profiler() : _enabled(true), _resetMs(0)
+    {
+        memset(_stats, 0, sizeof(_stats));
+    }
+
+    static inline uint8_t bucketFor(uint32_t us)
+    {
+        if (us < 2)
+            return 0;
+        uint8_t b = 31 - __builtin_clz(us);
+        return b < PROFILER_HIST_BUCKETS ? b : PROFILER_HIST_BUCKETS - 1;
+    }
+
+    bool _enabled;
+    unsigned long _resetMs;
+    SiteStats _stats[SITE_COUNT];
+};
+
+/// Shortcut macro to access the Profiler singleton
+#define PROF Profiler::instance()
+
+/**
+ * @class ProfileScope
+ * @brief RAII timer that records its lifetime into one or two sites.
+ */
+class ProfileScope
+{
+public:
+    explicit ProfileScope(uint8_t site, uint8_t site2 = Profiler::NO_SITE)
+        : _site(site), _site2(site2), _start(PROF.isEnabled() ? Profiler::now() : 0) {}
+
+    ~ProfileScope()
+    {
+        if (!PROF.isEnabled())
+            return;
+        uint32_t us = Profiler::now() - _start;
+        PROF.record(_site, us);
+        PROF.record(_site2, us);
+    }
+
+private:
+    uint8_t _site, _site2;
+    uint32_t _start;
+};
+
+#if PROFILER_ENABLED
+#define PROFILE_CONCAT_(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_(a, b)
+/// Time the rest of the enclosing block into the given site(s)
+#define PROFILE_SCOPE(...) ProfileScope PROFILE_CONCAT(_profScope, __LINE__)(__VA_ARGS__)
+#else
+#define PROFILE_SCOPE(...) \
+    do                     \
+    {                      \
+    } while (0)
+#endif
+
+#endif // PROFILER_H
@@ -0,0 +1,590 @@
+// File: Raster.h
+#ifndef RASTER_H
+#define RASTER_H
+
+#include <Arduino.h>
+#include <NeoPixelBus.h>
+#include "PixelSpan.h"
+
+/**
+ * @file Raster.h
+ * @brief Bulk drawing on pixel spans: fill, gradient, hue ramp, blit, replication, fade, blend and dither.
+ *
+ * All functions work on the span's raw bytes in wire order, so they are independent of
+ * the color feature. fill() and fade() handle the word-aligned middle of the span
+ * 32 bits at a time (4 pixels = PixelSize words for fill); the unaligned head and tail
+ * fall back to single pixels or bytes. Ramps step in 16.16 fixed point, with no
+ * per-pixel division.
+ *
+ * A "wide" buffer holds the same bytes as 8.8 fixed point (WIDE_MAX = 255.0), so
+ * blending and scaling keep their fractions until dither() quantizes them.
+ *
+ * Layers are canonical RGB. toWire() and dither() are the only passes that produce the
+ * bus's wire format; WireColor<> is specialized per color object, so white extraction
+ * for RGBW strips is resolved at compile time rather than per pixel.
+ */
+
+/// Layer blend modes. Format: X(ENUM_NAME, "command name")
+#define BLEND_MODE_LIST(X)  \
+    X(REPLACE, "replace")   \
+    X(ADD, "add")           \
+    X(MAX, "max")           \
+    X(MULTIPLY, "multiply") \
+    X(ALPHA, "alpha")
+
+namespace Raster
+{
+
+    enum class BlendMode : uint8_t
+    {
+#define BLEND_MODE_ENUM(name, label) name,
+        BLEND_MODE_LIST(BLEND_MODE_ENUM)
+#undef BLEND_MODE_ENUM
+            COUNT
+    };
+
+    /// 32-bit word that may alias the byte pixel buffer
+    typedef uint32_t __attribute__((__may_alias__)) Word;
+
+    /// Full scale of one channel of a wide buffer (255.0 in 8.8 fixed point)
+    static const uint16_t WIDE_MAX = 0xFF00;
+
+    /// Output scale that leaves a frame unchanged (scales are in 1/65536)
+    static const uint32_t SCALE_ONE = 0x10000;
+
+    /// Remap table entry of a wire pixel that shows nothing
+    static const uint16_t UNMAPPED = 0xFFFF;
+
+    /// Full-wheel hue step (16.16 fixed point) that spreads one hue turn across len pixels
+    inline uint32_t hueStep(uint16_t len)
+    {
+        return len ? (uint32_t)(0x100000000ULL / len) : 0;
+    }
+
+    /// Fully saturated, full-value color for a 16-bit hue
+    inline RgbColor hueColor(uint16_t hue)
+    {
+        return RgbColor(HsbColor(hue / 65535.0f, 1.0f, 1.0f));
+    }
+
+    /**
+     * @brief Set every pixel of the span to one color.
+     */
+    template <typename F>
+    void fill(BasicPixelSpan<F> px, const typename F::ColorObject &color)
+    {
+        uint8_t *p = px.data();
+        uint16_t n = px.size();
+        uint16_t i = 0;
+
+        // Head: single pixels until the write pointer is word aligned (never aligns if
+        // PixelSize is a multiple of 4 and the span is not, then the tail does it all)
+        for (uint8_t k = 0; k < 4 && i < n && (reinterpret_cast<uintptr_t>(p) & 3); ++k, ++i)
+        {
+            F::applyPixelColor(p, 0, color);
+            p += F::PixelSize;
+        }
+
+        if ((reinterpret_cast<uintptr_t>(p) & 3) == 0 && n - i >= 4)
+        {
+            // Four pixels are exactly PixelSize words
+            Word pattern[F::PixelSize];
+            uint8_t *bytes = reinterpret_cast<uint8_t *>(pattern);
+            for (uint8_t k = 0; k < 4; ++k)
+            {
+                F::applyPixelColor(bytes, k, color);
+            }
+            Word *w = reinterpret_cast<Word *>(p);
+            for (; n - i >= 4; i += 4)
+            {
+                for (uint8_t k = 0; k < F::PixelSize; ++k)
+                {
+                    *w++ = pattern[k];
+                }
+            }
+            p = reinterpret_cast<uint8_t *>(w);
+        }
+
+        for (; i < n; ++i)
+        {
+            F::applyPixelColor(p, 0, color);
+            p += F::PixelSize;
+        }
+    }
+
+    /**
+     * @brief Linear blend from c0 at the first pixel to c1 at the last.
+     */
+    template <typename F>
+    void gradient(BasicPixelSpan<F> px, const typename F::ColorObject &c0, const typename F::ColorObject &c1)
+    {
+        uint16_t n = px.size();
+        if (n == 0)
+            return;
+        uint8_t a[F::PixelSize], b[F::PixelSize];
+        F::applyPixelColor(a, 0, c0);
+        F::applyPixelColor(b, 0, c1);
+
+        // Per-channel 16.16 accumulators, stepping (b - a) / (n - 1) per pixel
+        int32_t acc[F::PixelSize], step[F::PixelSize];
+        for (uint8_t k = 0; k < F::PixelSize; ++k)
+        {
+            acc[k] = ((int32_t)a[k] << 16) + 0x8000;
+            step[k] = n > 1 ? (((int32_t)b[k] - a[k]) * 65536) / (n - 1) : 0;
+        }
+
+        uint8_t *p = px.data();
+        for (uint16_t i = 0; i < n; ++i)
+        {
+            for (uint8_t k = 0; k < F::PixelSize; ++k)
+            {
+                *p++ = (uint8_t)(acc[k] >> 16);
+                acc[k] += step[k];
+            }
+        }
+    }
+
+    /**
+     * @brief Rainbow along the span: pixel i gets hue startHue + i * step.
+     * @param step Hue advance per pixel in 16.16 fixed point; hueStep(len) spans one full turn.
+     */
+    template <typename F>
+    void hueRamp(BasicPixelSpan<F> px, uint16_t startHue, uint32_t step)
+    {
+        uint32_t acc = (uint32_t)startHue << 16;
+        uint8_t *p = px.data();
+        uint16_t n = px.size();
+        for (uint16_t i = 0; i < n; ++i)
+        {
+            F::applyPixelColor(p, 0, typename F::ColorObject(hueColor(acc >> 16)));
+            p += F::PixelSize;
+            acc += step;
+        }
+    }
+
+    /**
+     * @brief Palette along the span: pixel i gets table[(start + i * step) >> 8], one lookup per pixel.
+     * @param table 256-entry palette table (see Palette.h).
+     * @param step Advance per pixel in 8.24 fixed point; hueStep(len) spans the whole table.
+     */
+    template <typename F>
+    void paletteRamp(BasicPixelSpan<F> px, const RgbColor *table, uint16_t start, uint32_t step)
+    {
+        uint32_t acc = (uint32_t)start << 16;
+        uint8_t *p = px.data();
+        uint16_t n = px.size();
+        for (uint16_t i = 0; i < n; ++i)
+        {
+            F::applyPixelColor(p, 0, typename F::ColorObject(table[acc >> 24]));
+            p += F::PixelSize;
+            acc += step;
+        }
+    }
+
+    /**
+     * @brief Copy src into the start of dst (min of both sizes). The spans may overlap.
+     */
+    template <typename F>
+    void blit(BasicPixelSpan<F> dst, BasicPixelSpan<F> src)
+    {
+        uint16_t n = dst.size() < src.size() ? dst.size() : src.size();
+        memmove(dst.data(), src.data(), (size_t)n * F::PixelSize);
+    }
+
+    /**
+     * @brief Widen each of the first count pixels to group pixels, in place, filling the
+     *        first count * group pixels of px (clamped to the span).
+     */
+    template <typename F>
+    void spread(BasicPixelSpan<F> px, uint16_t count, uint8_t group)
+    {
+        uint8_t *p = px.data();
+        uint32_t end = px.size();
+        // Back to front: pixel i only lands on i * group and later, which are already read
+        for (uint32_t i = count; i-- > 0;)
+        {
+            uint8_t c[F::PixelSize];
+            memcpy(c, p + i * F::PixelSize, F::PixelSize);
+            uint32_t first = i * group;
+            uint32_t last = first + group < end ? first + group : end;
+            for (uint32_t j = first; j < last; ++j)
+            {
+                memcpy(p + j * F::PixelSize, c, F::PixelSize);
+            }
+        }
+    }
+
+    /**
+     * @brief Repeat the first count pixels to the end of the span. Each copy doubles the
+     *        filled part, so this is a handful of memcpy() calls.
+     */
+    template <typename F>
+    void tile(BasicPixelSpan<F> px, uint16_t count)
+    {
+        uint8_t *p = px.data();
+        size_t filled = (size_t)count * F::PixelSize;
+        size_t total = (size_t)px.size() * F::PixelSize;
+        while (filled && filled < total)
+        {
+            size_t n = filled < total - filled ? filled : total - filled;
+            memcpy(p + filled, p, n);
+            filled += n;
+        }
+    }
+
+    /**
+     * @brief Make the pixels after the first count a reversed copy of the start of the span,
+     *        so it reads the same from both ends (count at least half the span, rounded up).
+     */
+    template <typename F>
+    void mirror(BasicPixelSpan<F> px, uint16_t count)
+    {
+        uint8_t *p = px.data();
+        uint16_t n = px.size();
+        for (uint16_t i = 0; i + count < n; ++i)
+        {
+            memcpy(p + (size_t)(n - 1 - i) * F::PixelSize, p + (size_t)i * F::PixelSize, F::PixelSize);
+        }
+    }
+
+    /**
+     * @brief Darken every channel by amount/256 (0 = unchanged, 255 = almost black).
+     */
+    template <typename F>
+    void fade(BasicPixelSpan<F> px, uint8_t amount)
+    {
+        uint8_t *p = px.data();
+        uint8_t *end = p + (size_t)px.size() * F::PixelSize;
+        uint32_t scale = 256 - amount; // 1..256
+
+        while (p < end && (reinterpret_cast<uintptr_t>(p) & 3))
+        {
+            *p = (uint8_t)((*p * scale) >> 8);
+            ++p;
+        }
+
+        // Two bytes per 16-bit lane; 255 * 256 still fits in a lane
+        Word *w = reinterpret_cast<Word *>(p);
+        Word *wend = reinterpret_cast<Word *>(p + ((end - p) & ~(ptrdiff_t)3));
+        for (; w < wend; ++w)
+        {
+            uint32_t v = *w;
+            uint32_t even = ((v & 0x00FF00FF) * scale >> 8) & 0x00FF00FF;
+            uint32_t odd = (((v >> 8) & 0x00FF00FF) * scale) & 0xFF00FF00;
+            *w = even | odd;
+        }
+
+        for (p = reinterpret_cast<uint8_t *>(w); p < end; ++p)
+        {
+            *p = (uint8_t)((*p * scale) >> 8);
+        }
+    }
+
+    /// Source bytes as rendered; wide() gives them in 8.8 fixed point
+    struct Unscaled
+    {
+        uint8_t operator()(uint8_t b) const { return b; }
+        uint16_t wide(uint8_t b) const { return b << 8; }
+    };
+
+    /// Source bytes scaled by a layer gain (weight 1..256); wide() keeps the fraction
+    struct Scaled
+    {
+        uint16_t weight;
+        uint8_t operator()(uint8_t b) const { return (b * weight) >> 8; }
+        uint16_t wide(uint8_t b) const { return b * weight; }
+    };
+
+    /**
+     * @brief Apply op to every byte of dst against src, adding each wire position's
+     *        (new - old) total to delta so callers can track the buffer's byte sums.
+     *        The sums are in 8.8 fixed point, the same units as a wide buffer.
+     */
+    template <typename F, typename Op, typename Src>
+    inline void blendBytes(uint8_t *d, const uint8_t *s, uint16_t n, int32_t *delta, Op op, Src src)
+    {
+        int32_t acc[F::PixelSize] = {}; // Locals stay in registers; d may alias delta
+        for (uint16_t i = 0; i < n; ++i)
+        {
+            for (uint8_t k = 0; k < F::PixelSize; ++k, ++d, ++s)
+            {
+                uint8_t v = op(*d, src(*s));
+                acc[k] += v - *d;
+                *d = v;
+            }
+        }
+        for (uint8_t k = 0; k < F::PixelSize; ++k)
+        {
+            delta[k] += acc[k] << 8;
+        }
+    }
+
+    /// blendBytes() into a wide buffer; op gets the wide dst value and the src value in 8.8
+    template <typename F, typename Op, typename Src>
+    inline void blendWideBytes(uint16_t *d, const uint8_t *s, uint16_t n, int32_t *delta, Op op, Src src)
+    {
+        int32_t acc[F::PixelSize] = {};
+        for (uint16_t i = 0; i < n; ++i)
+        {
+            for (uint8_t k = 0; k < F::PixelSize; ++k, ++d, ++s)
+            {
+                uint16_t v = op(*d, src.wide(*s));
+                acc[k] += v - *d;
+                *d = v;
+            }
+        }
+        for (uint8_t k = 0; k < F::PixelSize; ++k)
+        {
+            delta[k] += acc[k];
+        }
+    }
+
+    /// blend() with each src byte passed through scale first
+    template <typename F, typename Src>
+    void blendScaled(BasicPixelSpan<F> dst, BasicPixelSpan<F> src, BlendMode mode, uint8_t opacity, int32_t *delta,
+                     Src scale)
+    {
+        uint8_t *d = dst.data();
+        const uint8_t *s = src.data();
+        uint16_t n = dst.size() < src.size() ? dst.size() : src.size();
+
+        switch (mode)
+        {
+        case BlendMode::REPLACE:
+            blendBytes<F>(d, s, n, delta, [](uint8_t a, uint8_t b) -> uint8_t { return b; }, scale);
+            break;
+        case BlendMode::ADD:
+            blendBytes<F>(d, s, n, delta, [](uint8_t a, uint8_t b) -> uint8_t {
+                uint16_t v = a + b;
+                return v > 255 ? 255 : v;
+            }, scale);
+            break;
+        case BlendMode::MAX:
+            blendBytes<F>(d, s, n, delta, [](uint8_t a, uint8_t b) -> uint8_t { return b > a ? b : a; }, scale);
+            break;
+        case BlendMode::MULTIPLY:
+            blendBytes<F>(d, s, n, delta, [](uint8_t a, uint8_t b) -> uint8_t { return (a * (b + 1)) >> 8; }, scale);
+            break;
+        case BlendMode::ALPHA:
+        {
+            int16_t weight = opacity + 1; // 1..256, so 255 copies src exactly
+            blendBytes<F>(d, s, n, delta, [weight](uint8_t a, uint8_t b) -> uint8_t {
+                return a + (((b - a) * weight) >> 8);
+            }, scale);
+            break;
+        }
+        default:
+            break;
+        }
+    }
+
+    /**
+     * @brief Combine src into dst channel by channel (min of both sizes).
+     * @param opacity Weight of src for ALPHA (0 = keep dst, 255 = src); ignored by the other modes.
+     * @param delta PixelSize running sums of dst (8.8 fixed point), updated by the change this blend makes.
+     * @param gain Scale of src before it is combined (255 = as rendered), for every mode.
+     */
+    template <typename F>
+    void blend(BasicPixelSpan<F> dst, BasicPixelSpan<F> src, BlendMode mode, uint8_t opacity, int32_t *delta,
+               uint8_t gain = 255)
+    {
+        if (gain == 255)
+        {
+            blendScaled(dst, src, mode, opacity, delta, Unscaled());
+        }
+        else
+        {
+            blendScaled(dst, src, mode, opacity, delta, Scaled{(uint16_t)(gain + 1)});
+        }
+    }
+
+    /// Wide blend() with each src byte passed through scale first
+    template <typename F, typename Src>
+    void blendScaled(uint16_t *dst, BasicPixelSpan<F> src, BlendMode mode, uint8_t opacity, int32_t *delta, Src scale)
+    {
+        const uint8_t *s = src.data();
+        uint16_t n = src.size();
+
+        switch (mode)
+        {
+        case BlendMode::REPLACE:
+            blendWideBytes<F>(dst, s, n, delta, [](uint16_t a, uint16_t b) -> uint16_t { return b; }, scale);
+            break;
+        case BlendMode::ADD:
+            blendWideBytes<F>(dst, s, n, delta, [](uint16_t a, uint16_t b) -> uint16_t {
+                uint32_t v = (uint32_t)a + b;
+                return v > WIDE_MAX ? WIDE_MAX : v;
+            }, scale);
+            break;
+        case BlendMode::MAX:
+            blendWideBytes<F>(dst, s, n, delta, [](uint16_t a, uint16_t b) -> uint16_t { return b > a ? b : a; }, scale);
+            break;
+        case BlendMode::MULTIPLY:
+            blendWideBytes<F>(dst, s, n, delta, [](uint16_t a, uint16_t b) -> uint16_t {
+                return ((uint32_t)a * ((b >> 8) + 1)) >> 8;
+            }, scale);
+            break;
+        case BlendMode::ALPHA:
+        {
+            int32_t weight = opacity + 1;
+            blendWideBytes<F>(dst, s, n, delta, [weight](uint16_t a, uint16_t b) -> uint16_t {
+                return a + ((((int32_t)b - a) * weight) >> 8);
+            }, scale);
+            break;
+        }
+        default:
+            break;
+        }
+    }
+
+    /**
+     * @brief blend() src into a wide buffer of at least src.size() pixels. The gain and the
+     *        ALPHA and MULTIPLY blends keep 8 fractional bits instead of truncating to whole steps.
+     */
+    template <typename F>
+    void blend(uint16_t *dst, BasicPixelSpan<F> src, BlendMode mode, uint8_t opacity, int32_t *delta,
+               uint8_t gain = 255)
+    {
+        if (gain == 255)
+        {
+            blendScaled(dst, src, mode, opacity, delta, Unscaled());
+        }
+        else
+        {
+            blendScaled(dst, src, mode, opacity, delta, Scaled{(uint16_t)(gain + 1)});
+        }
+    }
+
+    /**
+     * @brief Canonical R, G, B channel values to the channels of a wire color object.
+     */
+    template <typename C>
+    struct WireColor;
+
+    template <>
+    struct WireColor<RgbColor>
+    {
+        static const uint8_t Channels = 3;
+        static inline void split(uint16_t *v) {}
+        static inline RgbColor make(const uint8_t *c) { return RgbColor(c[0], c[1], c[2]); }
+    };
+
+    template <>
+    struct WireColor<RgbwColor>
+    {
+        static const uint8_t Channels = 4;
+        /// Move the part common to R, G and B onto the white LED
+        static inline void split(uint16_t *v)
+        {
+            uint16_t w = v[0] < v[1] ? v[0] : v[1];
+            w = v[2] < w ? v[2] : w;
+            v[0] -= w;
+            v[1] -= w;
+            v[2] -= w;
+            v[3] = w;
+        }
+        static inline RgbwColor make(const uint8_t *c) { return RgbwColor(c[0], c[1], c[2], c[3]); }
+    };
+
+    /// One canonical color as feature F's color object
+    template <typename F>
+    inline typename F::ColorObject wireColor(const RgbColor &color)
+    {
+        typedef WireColor<typename F::ColorObject> W;
+        uint16_t v[W::Channels] = {color.R, color.G, color.B};
+        W::split(v);
+        uint8_t c[W::Channels];
+        for (uint8_t k = 0; k < W::Channels; ++k)
+        {
+            c[k] = (uint8_t)v[k];
+        }
+        return W::make(c);
+    }
+
+    /**
+     * @brief Convert count canonical RGB pixels from src to F's wire format in dst. dst may
+     *        be src (in place): it runs from the last pixel down, as a wire pixel is never smaller.
+     */
+    template <typename F>
+    void toWire(uint8_t *dst, const uint8_t *src, uint16_t count)
+    {
+        static_assert(F::PixelSize >= 3, "Wire pixels must hold canonical RGB");
+        for (uint16_t i = count; i-- > 0;)
+        {
+            const uint8_t *p = src + (size_t)i * 3;
+            F::applyPixelColor(dst, i, wireColor<F>(RgbColor(p[0], p[1], p[2])));
+        }
+    }
+
+    /**
+     * @brief toWire() through a remap: wire pixel i shows src pixel map[i] (UNMAPPED = off).
+     *        dst must not overlap src.
+     */
+    template <typename F>
+    void toWire(uint8_t *dst, const uint8_t *src, uint16_t count, const uint16_t *map)
+    {
+        static const uint8_t off[3] = {};
+        for (uint16_t i = 0; i < count; ++i)
+        {
+            uint16_t l = map[i];
+            const uint8_t *p = l == UNMAPPED ? off : src + (size_t)l * 3;
+            F::applyPixelColor(dst, i, wireColor<F>(RgbColor(p[0], p[1], p[2])));
+        }
+    }
+
+    /// Scale, split and dither one canonical wide pixel into wire pixel i of out
+    template <typename F>
+    inline void ditherPixel(uint8_t *out, uint16_t i, const uint16_t *wide, uint8_t *residual, uint32_t scale)
+    {
+        typedef WireColor<typename F::ColorObject> W;
+        // WIDE_MAX * SCALE_ONE fits 32 bits, and WIDE_MAX + 0xFF still rounds down to 255
+        uint16_t v[W::Channels];
+        for (uint8_t k = 0; k < 3; ++k)
+        {
+            v[k] = ((uint32_t)wide[k] * scale) >> 16;
+        }
+        W::split(v);
+        uint8_t c[W::Channels];
+        for (uint8_t k = 0; k < W::Channels; ++k)
+        {
+            uint16_t t = v[k] + residual[k];
+            residual[k] = (uint8_t)t;
+            c[k] = t >> 8;
+        }
+        F::applyPixelColor(out, i, W::make(c));
+    }
+
+    /**
+     * @brief Scale count canonical wide pixels by scale/65536 and quantize them to F's wire
+     *        format with temporal error diffusion: each wire channel's remainder is kept in
+     *        residual (WireColor Channels bytes per pixel) and added on the next call, so
+     *        over a few frames a channel averages to its exact value. Call once per frame
+     *        sent, even if the wide buffer did not change.
+     */
+    template <typename F>
+    void dither(uint8_t *out, const uint16_t *wide, uint8_t *residual, uint16_t count, uint32_t scale)
+    {
+        const uint8_t channels = WireColor<typename F::ColorObject>::Channels;
+        for (uint16_t i = 0; i < count; ++i, wide += 3, residual += channels)
+        {
+            ditherPixel<F>(out, i, wide, residual, scale);
+        }
+    }
+
+    /// dither() through a remap: wire pixel i shows wide pixel map[i] (UNMAPPED = off)
+    template <typename F>
+    void dither(uint8_t *out, const uint16_t *wide, uint8_t *residual, uint16_t count, uint32_t scale,
+                const uint16_t *map)
+    {
+        static const uint16_t off[3] = {};
+        const uint8_t channels = WireColor<typename F::ColorObject>::Channels;
+        for (uint16_t i = 0; i < count; ++i, residual += channels)
+        {
+            uint16_t l = map[i];
+            ditherPixel<F>(out, i, l == UNMAPPED ? off : wide + (size_t)l * 3, residual, scale);
+        }
+    }
+
+} // namespace Raster
+
+#endif // RASTER_H
@@ -17,16 +17,13 @@ bool Accelerometer::begin()
 {
     if (!IMU.begin())
     {
-        DBG.print("Accel", 1, "Failed to initialize IMU!");
+        DBG_LOG(DBG_ACCEL, 1, "Failed to initialize IMU!");
         return false;
     }
     _sampleRate = IMU.accelerationSampleRate();
-    DBG.print("Accel", 1, "Accelerometer sample rate = ");
-    DBG.print("Accel", 1, _sampleRate);
-    DBG.print("Accel", 1, " Hz");
-    DBG.print("Accel", 1, "");
-    DBG.print("Accel", 1, "Acceleration in g's");
-    DBG.print("Accel", 1, "X\tY\tZ");
+    DBG_LOG(DBG_ACCEL, 1, "Accelerometer sample rate = %d Hz", _sampleRate);
+    DBG_LOG(DBG_ACCEL, 1, "Acceleration in g's");
+    DBG_LOG(DBG_ACCEL, 1, "X\tY\tZ");
     return true;
 }
 
@@ -36,7 +33,7 @@ bool Accelerometer::begin()
 void Accelerometer::stop()
 {
     IMU.end();
-    DBG.print("Accel", 1, "Accelerometer stopped");
+    DBG_LOG(DBG_ACCEL, 1, "Accelerometer stopped");
 }
 
 /**
@@ -45,9 +42,7 @@ void Accelerometer::stop()
  */
 float Accelerometer::sampleRate() const
 {
-    DBG.print("Accel", 2,
-              String("Sample Rate Requested = ") +
-                  String(_sampleRate) + " Hz");
+    DBG_LOG(DBG_ACCEL, 2, "Sample Rate Requested = %d Hz", _sampleRate);
     return _sampleRate;
 }
 
@@ -58,9 +53,7 @@ float Accelerometer::sampleRate() const
 bool Accelerometer::available() const
 {
     bool ready = IMU.accelerationAvailable();
-    DBG.print("Accel", 3,
-              String("accelerationAvailable() → ") +
-                  (ready ? "true" : "false"));
+    DBG_LOG(DBG_ACCEL, 3, "accelerationAvailable() → %s", ready ? "true" : "false");
     return ready;
 }
 
@@ -73,10 +66,7 @@ bool Accelerometer::available() const
 void Accelerometer::read(float &x, float &y, float &z)
 {
     IMU.readAcceleration(x, y, z);
-    DBG.print("Accel", 3,
-              String("readAcceleration(): X=") + String(x, 3) +
-                  ", Y=" + String(y, 3) +
-                  ", Z=" + String(z, 3));
+    DBG_LOG(DBG_ACCEL, 3, "readAcceleration(): X=%.3f, Y=%.3f, Z=%.3f", x, y, z);
 }
 
 /**
@@ -87,8 +77,7 @@ void Accelerometer::readX(float &x)
 {
     float unusedY, unusedZ;
     IMU.readAcceleration(x, unusedY, unusedZ);
-    DBG.print("Accel", 2,
-              String("readAcceleration(): X=") + String(x, 3));
+    DBG_LOG(DBG_ACCEL, 2, "readAcceleration(): X=%.3f", x);
 }
 
 /**
@@ -99,8 +88,7 @@ void Accelerometer::readY(float &y)
 {
     float unusedX, unusedZ;
     IMU.readAcceleration(unusedX, y, unusedZ);
-    DBG.print("Accel", 2,
-              String("readAcceleration(): Y=") + String(y, 3));
+    DBG_LOG(DBG_ACCEL, 2, "readAcceleration(): Y=%.3f", y);
 }
 
 /**
@@ -111,8 +99,7 @@ void Accelerometer::readZ(float &z)
 {
     float unusedX, unusedY;
     IMU.readAcceleration(unusedX, unusedY, z);
-    DBG.print("Accel", 2,
-              String("readAcceleration(): Z=") + String(z, 3));
+    DBG_LOG(DBG_ACCEL, 2, "readAcceleration(): Z=%.3f", z);
 }
 
 // ——— TEMPERATURE SENSOR ————————————————————————————————————————
@@ -125,15 +112,15 @@ bool TemperatureSensor::begin()
 {
     if (!IMU.begin())
     {
-        DBG.print("Temp", 1, "Failed to initialize IMU for temperature");
+        DBG_LOG(DBG_TEMP, 1, "Failed to initialize IMU for temperature");
         return false;
     }
     if (!IMU.temperatureAvailable())
     {
-        DBG.print("Temp", 1, "Temperature sensor not available");
+        DBG_LOG(DBG_TEMP, 1, "Temperature sensor not available");
         return false;
     }
-    DBG.print("Temp", 1, "Temperature sensor ready");
+    DBG_LOG(DBG_TEMP, 1, "Temperature sensor ready");
     return true;
 }
 
@@ -143,7 +130,7 @@ bool TemperatureSensor::begin()
 void TemperatureSensor::stop()
 {
     IMU.end();
-    DBG.print("Temp", 1, "Temperature sensor stopped");
+    DBG_LOG(DBG_TEMP, 1, "Temperature sensor stopped");
 }
 
 /**
@@ -153,9 +140,7 @@ void TemperatureSensor::stop()
 bool TemperatureSensor::available() const
 {
     bool ready = IMU.temperatureAvailable();
-    DBG.print("Temp", 1,
-              String("temperatureAvailable() → ") +
-                  (ready ? "true" : "false"));
+    DBG_LOG(DBG_TEMP, 1, "temperatureAvailable() → %s", ready ? "true" : "false");
     return ready;
 }
 
@@ -168,8 +153,7 @@ float TemperatureSensor::readCelsius()
     int rawTemp = 0;
     IMU.readTemperature(rawTemp);
     float celsius = static_cast<float>(rawTemp);
-    DBG.print("Temp", 1,
-              String("Temperature (°C) = ") + String(celsius, 2));
+    DBG_LOG(DBG_TEMP, 1, "Temperature (°C) = %.2f", celsius);
     return celsius;
 }
 
@@ -181,8 +165,7 @@ float TemperatureSensor::readFahrenheit()
 {
     float c = readCelsius();
     float f = c * 9.0f / 5.0f + 32.0f;
-    DBG.print("Temp", 1,
-              String("Temperature (°F) = ") + String(f, 2));
+    DBG_LOG(DBG_TEMP, 1, "Temperature (°F) = %.2f", f);
     return f;
 }
 
@@ -228,11 +211,11 @@ void Microphone::begin()
 {
     if (!PDM.begin(1, SAMPLE_RATE))
     {
-        DBG.print("Mic", 1, "PDM.begin() failed!");
+        DBG_LOG(DBG_MICROPHONE, 1, "PDM.begin() failed!");
         return;
     }
     PDM.onReceive(Microphone::onPDMDataStatic);
-    DBG.print("Mic", 1, "Microphone started");
+    DBG_LOG(DBG_MICROPHONE, 1, "Microphone started");
 }
 
 /**
@@ -241,7 +224,7 @@ void Microphone::begin()
 void Microphone::stop()
 {
     PDM.end();
-    DBG.print("Mic", 2, "Microphone stopped");
+    DBG_LOG(DBG_MICROPHONE, 2, "Microphone stopped");
 }
 
 /**
@@ -373,8 +356,7 @@ bool Microphone::available() const
 void Microphone::setThreshold(int threshold)
 {
     _amplitudeThreshold = threshold;
-    DBG.print("Mic", 2,
-              String("Threshold set to ") + String(_amplitudeThreshold));
+    DBG_LOG(DBG_MICROPHONE, 2, "Threshold set to %d", _amplitudeThreshold);
 }
 
 /**
@@ -391,7 +373,6 @@ int Microphone::readPeak()
             peak = v;
     }
     _samplesRead = 0;
-    DBG.print("Mic", 3,
-              String("Peak amplitude = ") + String(peak));
+    DBG_LOG(DBG_MICROPHONE, 3, "Peak amplitude = %d", peak);
     return peak;
 }
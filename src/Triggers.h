@@ -47,6 +47,13 @@ public:
             bassMagnitude += vReal[i];
         }
 
+        // Band levels for the modulation matrix: each band's mean bin magnitude, scaled so
+        // that the bass reads 255 at peakMax
+        levels_[0] = bandLevel(bassMagnitude, 4);
+        levels_[1] = bandLevel(binSum(5, MID_LAST_BIN), MID_LAST_BIN - 4);
+        levels_[2] = bandLevel(binSum(MID_LAST_BIN + 1, SAMPLES / 2 - 1), SAMPLES / 2 - 1 - MID_LAST_BIN);
+        beat_ = bassMagnitude > threshold_;
+
         // Print the detected magnitude for easy tuning of the threshold
         // Serial.print("Bass Magnitude: ");
         // Serial.println(bassMagnitude);
@@ -65,7 +72,37 @@ public:
         threshold_ = newThreshold;
     }
 
+    // Level (0-255) of band 0 (bass, bins 1-4), 1 (mid, up to MID_LAST_BIN) or 2 (treble)
+    // from the last update()
+    uint8_t level(uint8_t band) const {
+        return band < 3 ? levels_[band] : 0;
+    }
+
+    // True if the last update() found the bass over the threshold
+    bool beat() const {
+        return beat_;
+    }
+
 private:
+    // Last mid bin: 2 kHz at the sketch's 16 kHz / 256-sample setup (62.5 Hz per bin)
+    static const int MID_LAST_BIN = SAMPLES / 8;
+
+    double binSum(int first, int last) const {
+        double sum = 0;
+        for (int i = first; i <= last; i++) {
+            sum += vReal[i];
+        }
+        return sum;
+    }
+
+    uint8_t bandLevel(double sum, int bins) const {
+        double level = sum * 4 / bins * 255 / peakMax_;
+        return level >= 255 ? 255 : (uint8_t)level;
+    }
+
+    uint8_t levels_[3] = {0, 0, 0};
+    bool beat_ = false;
+
     int threshold_;
     int peakMax_;
     int minBrightness_;
@@ -12,35 +12,37 @@ namespace AccelMeter
 
     const int BUBBLE_SIZE = 5;
 
-    inline void start(PixelStrip::Segment *seg, uint32_t color1, uint32_t color2)
+    struct State
     {
-        seg->setEffect(PixelStrip::Segment::SegmentEffect::ACCEL_METER);
-        seg->active = true;
-        seg->interval = 10;
-        seg->baseColor = color1;
+    }; // Uses the segment's baseColor and the global accelX only
+
+    inline ParamList params()
+    {
+        static const ParamSpec specs[] = {PARAM_COLOR, PARAM_INTERVAL(1, 1000)};
+        return specs;
     }
 
-    inline void update(PixelStrip::Segment *seg)
+    inline void start(PixelStrip::Segment *seg, State &st)
     {
-        if (!seg->active || (millis() - seg->lastUpdate < seg->interval))
-        {
-            return;
-        }
-        seg->lastUpdate = millis();
+        seg->interval = 10;
+    }
 
-        int startPixel = seg->startIndex();
-        int endPixel = seg->endIndex();
-        int numPixels = endPixel - startPixel + 1;
+    inline void render(PixelStrip::Segment *seg, State &st, PixelSpan px)
+    {
+        int numPixels = px.size();
 
         float mappedPosition = (accelX + 1.0f) * (float)(numPixels - BUBBLE_SIZE) / 2.0f;
-        int bubbleCenter = constrain((int)mappedPosition, 0, numPixels - BUBBLE_SIZE) + startPixel;
+        int bubbleStart = constrain((int)mappedPosition, 0, numPixels - BUBBLE_SIZE);
 
-        RgbColor bubbleColor((seg->baseColor >> 16) & 0xFF, (seg->baseColor >> 8) & 0xFF, seg->baseColor & 0xFF);
-        seg->allOff();
+        RgbColor bubbleColor = PixelStrip::ColorToRgb(seg->baseColor);
+        px.clear();
 
         for (int i = 0; i < BUBBLE_SIZE; i++)
         {
-            seg->getParent().getStrip().SetPixelColor(bubbleCenter + i, bubbleColor);
+            if (px.contains(bubbleStart + i))
+            {
+                px.set(bubbleStart + i, bubbleColor);
+            }
         }
     }
 
@@ -2,78 +2,89 @@
 #define COLOREDFIRE_H
 
 #include "../PixelStrip.h"
+#include "Heat.h"
 #include <Arduino.h>
 
 namespace ColoredFire {
 
+// Gradient colors (base, middle, tips), kept per segment
+struct State {
+    RgbColor color1 = RgbColor(0, 0, 0);
+    RgbColor color2 = RgbColor(255, 0, 0);
+    RgbColor color3 = RgbColor(255, 255, 0);
+    uint8_t sparking = 120;
+    uint8_t cooling = 55;
+};
+
 // --- Effect-specific constants ---
-const int MAX_LEDS_FIRE = 300; 
-static byte heat[MAX_LEDS_FIRE];
+alignas(4) static byte heat[Heat::MAX_CELLS];
+
+// Palettes expanded from the three colors (stops at 0, 128 and 255), shared by the
+// segments that use the same colors. A segment whose colors none of them holds reloads
+// the least recently used one, so up to this many color sets render from a table.
+#ifndef COLOREDFIRE_TABLES
+#define COLOREDFIRE_TABLES 4
+#endif
+static Palette tables[COLOREDFIRE_TABLES];
+static uint32_t tableUsed[COLOREDFIRE_TABLES];
+static uint32_t tableClock = 0;
 
 // --- Helper Functions ---
 
-inline byte qadd8(byte a, byte b) {
-    unsigned int sum = a + b;
-    if (sum > 255) return 255;
-    return static_cast<byte>(sum);
-}
-
-inline byte qsub8(byte a, byte b) {
-    if (b > a) return 0;
-    return a - b;
-}
-
-inline byte lerp8(byte a, byte b, byte t) {
-    return a + ((long)(b - a) * t) / 255;
-}
-
-inline RgbColor ThreeColorHeatColor(byte heat, RgbColor c1, RgbColor c2, RgbColor c3) {
-    if (heat <= 127) {
-        byte t = heat * 2;
-        return RgbColor(lerp8(c1.R, c2.R, t), lerp8(c1.G, c2.G, t), lerp8(c1.B, c2.B, t));
-    } else {
-        byte t = (heat - 128) * 2;
-        return RgbColor(lerp8(c2.R, c3.R, t), lerp8(c2.G, c3.G, t), lerp8(c2.B, c3.B, t));
+inline const RgbColor* colorTable(const State& st) {
+    const uint8_t blob[] = {0,   st.color1.R, st.color1.G, st.color1.B, 128, st.color2.R, st.color2.G, st.color2.B,
+                            255, st.color3.R, st.color3.G, st.color3.B};
+    uint8_t slot = 0;
+    bool found = false;
+    for (uint8_t i = 0; i < COLOREDFIRE_TABLES && !found; i++) {
+        if (tables[i].holds(blob, sizeof(blob))) {
+            slot = i;
+            found = true;
+        } else if (tableUsed[i] < tableUsed[slot]) {
+            slot = i;
+        }
     }
+    if (!found) {
+        tables[slot].load(blob, sizeof(blob));
+    }
+    tableUsed[slot] = ++tableClock;
+    return tables[slot].table();
 }
 
 // --- Main Effect Functions (Implemented Inline) ---
 
-inline void start(PixelStrip::Segment* seg, uint32_t color1, uint32_t color2) {
-    seg->setEffect(PixelStrip::Segment::SegmentEffect::COLORED_FIRE);
-    seg->active = true;
-    seg->interval = 15;
+inline ParamList params() {
+    static const ParamSpec specs[] = {
+        PARAM_FIELD(State, color1, "base", RGB, 0, 0xFFFFFF),
+        PARAM_FIELD(State, color2, "middle", RGB, 0, 0xFFFFFF),
+        PARAM_FIELD(State, color3, "tips", RGB, 0, 0xFFFFFF),
+        PARAM_FIELD(State, sparking, "sparking", U8, 0, 255),
+        PARAM_FIELD(State, cooling, "cooling", U8, 1, 100),
+        PARAM_INTERVAL(1, 1000),
+    };
+    return specs;
 }
 
-inline void update(PixelStrip::Segment* seg) {
-    if (!seg->active || (millis() - seg->lastUpdate < seg->interval)) {
-        return;
-    }
-    seg->lastUpdate = millis();
-
-    int start = seg->startIndex();
-    int end = seg->endIndex();
-    int len = (end - start + 1);
-
-    for (int i = start; i <= end; i++) {
-        heat[i] = qsub8(heat[i], random(0, ((seg->fireCooling * 10) / len) + 2));
-    }
-  
-    for (int k = end; k >= start + 2; k--) {
-        heat[k] = (heat[k - 1] + heat[k - 2] + heat[k - 2]) / 3;
-    }
-    
-    if (random(255) < seg->fireSparking) {
-        int y = start + random(7);
-        heat[y] = qadd8(heat[y], random(160, 255));
-    }
+inline void start(PixelStrip::Segment* seg, State& st) {
+    seg->interval = 15;
+    memset(heat + seg->startIndex(), 0, seg->renderPixels().size());
+}
 
-    RgbColor c1((seg->fireColor1 >> 16) & 0xFF, (seg->fireColor1 >> 8) & 0xFF, seg->fireColor1 & 0xFF);
-    RgbColor c2((seg->fireColor2 >> 16) & 0xFF, (seg->fireColor2 >> 8) & 0xFF, seg->fireColor2 & 0xFF);
-    RgbColor c3((seg->fireColor3 >> 16) & 0xFF, (seg->fireColor3 >> 8) & 0xFF, seg->fireColor3 & 0xFF);
-    for (int j = start; j <= end; j++) {
-        RgbColor color = ThreeColorHeatColor(heat[j], c1, c2, c3);
-        seg->getParent().getStrip().SetPixelColor(j, color);
+inline void render(PixelStrip::Segment* seg, State& st, PixelSpan px) {
+    int len = px.size();
+    if (len == 0) return;
+    byte* h = heat + seg->startIndex(); // This segment's heat cells
+    FastRandom& rng = seg->rng();
+
+    Heat::cool(h, len, Heat::coolingRange(st.cooling, len), rng);
+    Heat::drift(h, len);
+    Heat::spark(h, len, st.sparking, rng);
+
+    // A palette selected on the segment replaces the three colors
+    const RgbColor* palette =
+        seg->getPalette() != PaletteBank::NONE ? seg->palette(PaletteBank::HEAT) : colorTable(st);
+    for (int j = 0; j < len; j++) {
+        px.set(j, palette[h[j]]);
     }
 }
 
@@ -14,7 +14,11 @@
     X(FLARE, Flare)                  \
     X(COLORED_FIRE, ColoredFire) \
     X(ACCEL_METER, AccelMeter) \
-    X(KINETIC_RIPPLE, KineticRipple)
+    X(KINETIC_RIPPLE, KineticRipple) \
+    X(FIRE_2D, Fire2D) \
+    X(KINETIC_RIPPLE_2D, KineticRipple2D) \
+    X(LAVA, Lava) \
+    X(OCEAN, Ocean)
 // * When you create a new effect, add its X macro line here. *
 
 #endif // EFFECTS_H
\ No newline at end of file
@@ -2,94 +2,49 @@
 #define FIRE_H
 
 #include "../PixelStrip.h"
+#include "Heat.h"
 
 namespace Fire {
 
-// --- ADDED: Helper functions to replace missing library functions ---
-
-// qadd8: Adds two bytes with saturation at 255.
-inline byte qadd8(byte a, byte b) {
-    unsigned int sum = a + b;
-    if (sum > 255) {
-        return 255;
-    }
-    return static_cast<byte>(sum);
-}
-
-// qsub8: Subtracts one byte from another with saturation at 0.
-inline byte qsub8(byte a, byte b) {
-    if (b > a) {
-        return 0;
-    }
-    return a - b;
-}
-
-
-// --- Effect-specific constants you can tweak ---
-const int MAX_LEDS = 300; // Must be at least as large as your LED_COUNT
+// Configurable parameters, kept per segment
+struct State {
+    uint8_t sparking = 120;
+    uint8_t cooling = 55;
+};
 
 // Internal state array for the heat of each pixel
-static byte heat[MAX_LEDS];
-
-// This helper function maps a heat temperature (0-255) to a fire-like color
-RgbColor HeatColor(byte temperature) {
-    byte t192 = round((temperature / 255.0) * 191);
-    byte heatramp = t192 & 0x3F; // 0..63
-    heatramp <<= 2; // scale to 0..252
-    if( t192 > 0x80) { // 128
-        return RgbColor(255, 255, heatramp);
-    } else if( t192 > 0x40 ) { // 64
-        return RgbColor(255, heatramp, 0);
-    } else { // 0..63
-        return RgbColor(heatramp, 0, 0);
-    }
+alignas(4) static byte heat[Heat::MAX_CELLS];
+
+// Chance of a new spark per frame (of 255), how fast the flame cools (also Fire2D's)
+inline ParamList params() {
+    static const ParamSpec specs[] = {
+        PARAM_FIELD(State, sparking, "sparking", U8, 0, 255),
+        PARAM_FIELD(State, cooling, "cooling", U8, 1, 100),
+        PARAM_INTERVAL(1, 1000),
+    };
+    return specs;
 }
 
-inline void start(PixelStrip::Segment* seg, uint32_t color1, uint32_t color2) {
-    seg->setEffect(PixelStrip::Segment::SegmentEffect::FIRE);
-    seg->active = true;
-    seg->interval = (color1 > 0) ? color1 : 15; // Default to 15ms delay
-
-    // If a value for Sparking was passed, use it. Otherwise, keep the default.
-    if (color1 > 0 && color1 <= 255) {
-        seg->fireSparking = color1;
-    }
-    // If a value for Cooling was passed, use it. Otherwise, keep the default.
-    if (color2 > 0 && color2 <= 100) {
-        seg->fireCooling = color2;
-    }
+inline void start(PixelStrip::Segment* seg, State& st) {
+    seg->interval = 15;
+    // Start cold, so a seed replays the same flame
+    memset(heat + seg->startIndex(), 0, seg->renderPixels().size());
 }
 
-inline void update(PixelStrip::Segment* seg) {
-    if (!seg->active) return;
-
-    if (millis() - seg->lastUpdate < seg->interval) return;
-    seg->lastUpdate = millis();
+inline void render(PixelStrip::Segment* seg, State& st, PixelSpan px) {
+    int len = px.size();
+    if (len == 0) return;
+    byte* h = heat + seg->startIndex(); // This segment's heat cells
+    FastRandom& rng = seg->rng();
 
-    int start = seg->startIndex();
-    int end = seg->endIndex();
-    int len = (end - start + 1);
-
-    // Step 1. Cool down every cell a little
-    for (int i = start; i <= end; i++) {
-      heat[i] = qsub8(heat[i], random(0, ((seg->fireCooling * 10) / len) + 2));
-    }
-  
-    // Step 2. Heat from each cell drifts 'up' and diffuses a little
-    for (int k = end; k >= start + 2; k--) {
-      heat[k] = (heat[k - 1] + heat[k - 2] + heat[k - 2]) / 3;
-    }
-    
-    // Step 3. Randomly ignite new 'sparks' of heat at the bottom
-    if (random(255) < seg->fireSparking) {
-      int y = start + random(7);
-      heat[y] = qadd8(heat[y], random(160, 255));
-    }
+    Heat::cool(h, len, Heat::coolingRange(st.cooling, len), rng); // Step 1. Cool down every cell a little
+    Heat::drift(h, len);                                          // Step 2. Heat drifts 'up' and diffuses
+    Heat::spark(h, len, st.sparking, rng);                        // Step 3. Ignite new sparks at the bottom
 
     // Step 4. Map from heat cells to LED colors
-    for (int j = start; j <= end; j++) {
-      RgbColor color = HeatColor(heat[j]);
-      seg->getParent().getStrip().SetPixelColor(j, color);
+    const RgbColor* palette = seg->palette(PaletteBank::HEAT);
+    for (int j = 0; j < len; j++) {
+      px.set(j, palette[h[j]]);
     }
 }
 
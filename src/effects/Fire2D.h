@@ -0,0 +1,65 @@
+#ifndef FIRE2D_H
+#define FIRE2D_H
+
+#include "../PixelStrip.h"
+#include "Fire.h"
+
+// Fire on a 2D grid: every column is its own flame, burning upward from the bottom row.
+// Same parameters and palette as Fire; the segment's grid (setgrid) gives the columns.
+namespace Fire2D {
+
+// Sparking/cooling as in Fire, kept per segment
+typedef Fire::State State;
+
+// Heat of each cell, row-major like the grid; a segment uses the cells from its start index
+alignas(4) static byte heat[Heat::MAX_CELLS];
+
+inline ParamList params() {
+    return Fire::params();
+}
+
+inline void start(PixelStrip::Segment* seg, State& st) {
+    seg->interval = 15;
+    memset(heat + seg->startIndex(), 0, seg->renderPixels().size());
+}
+
+inline void render(PixelStrip::Segment* seg, State& st, PixelSpan px) {
+    PixelGrid grid(px, seg->gridWidth(), seg->gridHeight());
+    int w = grid.width();
+    int rows = grid.height();
+    if (grid.size() == 0) return;
+    byte* h = heat + seg->startIndex(); // This segment's heat cells
+    FastRandom& rng = seg->rng();
+
+    // Step 1. Cool down every cell a little (a column is as tall as the grid)
+    Heat::cool(h, grid.size(), Heat::coolingRange(st.cooling, rows), rng);
+
+    // Step 2. Heat drifts up each column and diffuses a little. Top rows first, so
+    // every row reads the two rows below it before they are updated.
+    for (int y = 0; y + 2 < rows; y++) {
+      Heat::riseRow(h + y * w, h + (y + 1) * w, h + (y + 2) * w, w);
+    }
+
+    // Step 3. Randomly ignite new 'sparks' of heat near the bottom of each column
+    int sparkRows = rows < 3 ? rows : 3;
+    for (int x = 0; x < w; x++) {
+      if (rng.below(255) < st.sparking) {
+        int y = rows - 1 - rng.below(sparkRows);
+        h[y * w + x] = Heat::qadd8(h[y * w + x], rng.range(160, 255));
+      }
+    }
+
+    // Step 4. Map from heat cells to LED colors, a row at a time
+    const RgbColor* palette = seg->palette(PaletteBank::HEAT);
+    for (int y = 0; y < rows; y++) {
+      PixelSpan row = grid.row(y);
+      const byte* rowHeat = h + y * w;
+      for (int x = 0; x < w; x++) {
+        row.set(x, palette[rowHeat[x]]);
+      }
+    }
+}
+
+}
+
+#endif
@@ -2,41 +2,40 @@
 #define FLASH_ON_TRIGGER_H
 
 #include "../PixelStrip.h"
+#include "../ModMatrix.h"
 
 namespace FlashOnTrigger {
 
-inline void start(PixelStrip::Segment* seg, uint32_t color1, uint32_t color2) {
-    if (!seg) return;
-    seg->setEffect(PixelStrip::Segment::SegmentEffect::FLASH_TRIGGER);
-    seg->active = true;
-    seg->baseColor = color1;
+// Draws the segment's baseColor at the level of an envelope following the audio trigger
+struct State {
+    uint8_t envelope = 1; // 1-2 = that envelope of the mod matrix, 0 = the raw trigger
+};
+
+inline ParamList params() {
+    static const ParamSpec specs[] = {
+        PARAM_COLOR,
+        PARAM_FIELD(State, envelope, "envelope", U8, 0, ModMatrix::ENVELOPES),
+    };
+    return specs;
 }
 
-// UPDATED: The signature is now standard. It gets the state from the segment object.
-inline void update(PixelStrip::Segment* seg) {
-    if (!seg->active) return;
-    
-    PixelStrip& strip = seg->getParent();
-
-    // Check the trigger state that is now stored inside the segment
-    if (seg->triggerIsActive) {
-        uint32_t baseColor = seg->baseColor;
-        uint8_t r = (baseColor >> 16) & 0xFF;
-        uint8_t g = (baseColor >> 8) & 0xFF;
-        uint8_t b = baseColor & 0xFF;
-        RgbColor finalColor(r, g, b);
-
-        // Use the brightness now stored inside the segment
-        finalColor.Dim(seg->triggerBrightness);
-        
-        for (uint16_t i = seg->startIndex(); i <= seg->endIndex(); ++i) {
-            strip.getStrip().SetPixelColor(i, finalColor);
-        }
+inline void start(PixelStrip::Segment* seg, State& st) {
+}
+
+inline void render(PixelStrip::Segment* seg, State& st, PixelSpan px) {
+    // The raw trigger snaps on and off once per audio block; an envelope swells and fades
+    uint8_t level = seg->triggerIsActive ? seg->triggerBrightness : 0;
+    if (st.envelope > 0) {
+        level = MODS.level(static_cast<ModMatrix::Source>(ModMatrix::ENV1 + st.envelope - 1));
+    }
+
+    if (level > 0) {
+        Raster::fill(px, PixelStrip::ColorToRgb(seg->baseColor).Dim(level)); // Dim() returns the dimmed copy
     } else {
-        seg->allOff();
+        px.clear();
     }
 }
 
 } 
 
-#endif
\ No newline at end of file
+#endif
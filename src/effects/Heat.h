@@ -0,0 +1,178 @@
+#ifndef HEAT_H
+#define HEAT_H
+
+#include "../PixelStrip.h"
+
+// Heat simulation shared by the fire family (Fire, Flare, ColoredFire, Fire2D).
+//
+// The cool and drift passes work on four cells per 32-bit word: a per-byte saturating
+// subtract for cooling, and for the drift a weighted average (a + 2b) * 85 >> 8 computed
+// in two 16-bit lanes per multiply, so no cell needs a divide (85/256 is 1/3 to within
+// one heat step). Cells outside whole aligned words go through the same arithmetic one
+// byte at a time. The *Reference functions are the plain per-cell
+// versions the word kernels must match bit for bit (see the `heatbench` command).
+namespace Heat {
+
+// Cells the heat arrays hold: every cell of the layer arena, so any segment fits
+const int MAX_CELLS = PIXELSTRIP_LAYER_PIXELS;
+
+// Adds two bytes with saturation at 255.
+inline byte qadd8(byte a, byte b) {
+    unsigned int sum = a + b;
+    if (sum > 255) {
+        return 255;
+    }
+    return static_cast<byte>(sum);
+}
+
+// Subtracts one byte from another with saturation at 0.
+inline byte qsub8(byte a, byte b) {
+    if (b > a) {
+        return 0;
+    }
+    return a - b;
+}
+
+// One heat step up the flame: (a + 2b) / 3, as multiply-shift
+inline byte rise(byte a, byte b) {
+    return ((a + b + b) * 85) >> 8;
+}
+
+// --- Word kernels (four cells per 32-bit word, little-endian: cell i is byte i) ---
+
+const uint32_t HIGH_BITS = 0x80808080UL;
+const uint32_t EVEN_BYTES = 0x00FF00FFUL;
+
+// Per-byte max(x - y, 0)
+inline uint32_t subSat4(uint32_t x, uint32_t y) {
+    uint32_t diff = ((x | HIGH_BITS) - (y & ~HIGH_BITS)) ^ ((x ^ ~y) & HIGH_BITS);
+    uint32_t borrow = ((~x & y) | (~(x ^ y) & diff)) & HIGH_BITS;
+    return diff & ~((borrow >> 7) * 0xFF);
+}
+
+// Per-byte (b * k) >> 8 for k <= 256; every 16-bit lane product stays below 65536
+inline uint32_t scale4(uint32_t bytes, uint32_t k) {
+    uint32_t even = (((bytes & EVEN_BYTES) * k) >> 8) & EVEN_BYTES;
+    uint32_t odd = (((bytes >> 8) & EVEN_BYTES) * k) & ~EVEN_BYTES;
+    return even | odd;
+}
+
+// Per-byte rise(a, b)
+inline uint32_t rise4(uint32_t a, uint32_t b) {
+    uint32_t even = ((((a & EVEN_BYTES) + ((b & EVEN_BYTES) << 1)) * 85) >> 8) & EVEN_BYTES;
+    uint32_t odd = ((((a >> 8) & EVEN_BYTES) + (((b >> 8) & EVEN_BYTES) << 1)) * 85) & ~EVEN_BYTES;
+    return even | odd;
+}
+
+inline bool aligned(const void* p) {
+    return (reinterpret_cast<uintptr_t>(p) & 3) == 0;
+}
+
+// Largest cooling draw for cooling (0-100) spread over a flame of the given height
+inline uint16_t coolingRange(uint8_t cooling, int height) {
+    uint16_t k = ((cooling * 10) / height) + 2;
+    return k > 256 ? 256 : k;
+}
+
+/**
+ * Step 1. Cool every cell by a random amount below k (k <= 256). One 32-bit draw covers
+ * four cells, counted from the first cell of the run, so a seed replays the same frames
+ * wherever the segment sits in the heat array. Word-aligned runs cool a word per draw;
+ * others apply the same four amounts a byte at a time.
+ */
+inline void cool(byte* h, int len, uint16_t k, FastRandom& rng) {
+    int i = 0;
+    if (aligned(h)) {
+        for (; len - i >= 4; i += 4) {
+            Raster::Word* w = reinterpret_cast<Raster::Word*>(h + i);
+            *w = subSat4(*w, scale4(rng.next(), k));
+        }
+    }
+    while (i < len) {
+        uint32_t amounts = scale4(rng.next(), k);
+        for (int end = i + 4 < len ? i + 4 : len; i < end; i++, amounts >>= 8) {
+            h[i] = qsub8(h[i], amounts & 0xFF);
+        }
+    }
+}
+
+inline void coolReference(byte* h, int len, uint16_t k, FastRandom& rng) {
+    uint32_t r = 0;
+    for (int i = 0; i < len; i++) {
+        if ((i & 3) == 0) {
+            r = rng.next();
+        }
+        byte amount = (((r >> (8 * (i & 3))) & 0xFF) * k) >> 8;
+        h[i] = qsub8(h[i], amount);
+    }
+}
+
+/**
+ * Step 2. Heat from each cell drifts 'up' (towards the end) and diffuses a little:
+ * every cell from 2 on becomes rise(h[k - 1], h[k - 2]) of the old values. Runs from
+ * the end down, so the cells below a word are still old when it reads them.
+ */
+inline void drift(byte* h, int len) {
+    if (len < 3) return;
+    byte* first = h + 2; // Lowest cell that changes
+    byte* end = h + len;
+    byte* wordsBegin = first + ((4 - (reinterpret_cast<uintptr_t>(first) & 3)) & 3);
+    byte* wordsEnd = end - (reinterpret_cast<uintptr_t>(end) & 3);
+    if (wordsEnd <= wordsBegin) {
+        wordsBegin = wordsEnd = end; // Too short for a whole word
+    }
+    for (byte* p = end; p-- > wordsEnd;) {
+        *p = rise(p[-1], p[-2]);
+    }
+    for (byte* p = wordsEnd; p > wordsBegin;) {
+        p -= 4;
+        Raster::Word* w = reinterpret_cast<Raster::Word*>(p);
+        uint32_t cur = *w;
+        uint32_t below = (cur << 8) | p[-1];                        // cells k - 1
+        uint32_t below2 = (cur << 16) | ((uint32_t)p[-1] << 8) | p[-2]; // cells k - 2
+        *w = rise4(below, below2);
+    }
+    for (byte* p = wordsBegin; p-- > first;) {
+        *p = rise(p[-1], p[-2]);
+    }
+}
+
+inline void driftReference(byte* h, int len) {
+    for (int k = len - 1; k >= 2; k--) {
+        h[k] = rise(h[k - 1], h[k - 2]);
+    }
+}
+
+/**
+ * 2D drift: dst[i] = rise(below[i], below2[i]) for three separate rows (a column's
+ * cells one and two rows lower). Word-parallel when the rows share an alignment, as
+ * they do for grids whose width is a multiple of 4.
+ */
+inline void riseRow(byte* dst, const byte* below, const byte* below2, int n) {
+    int i = 0;
+    uintptr_t lane = reinterpret_cast<uintptr_t>(dst) & 3;
+    if (lane == (reinterpret_cast<uintptr_t>(below) & 3) && lane == (reinterpret_cast<uintptr_t>(below2) & 3)) {
+        for (; i < n && !aligned(dst + i); i++) {
+            dst[i] = rise(below[i], below2[i]);
+        }
+        for (; n - i >= 4; i += 4) {
+            *reinterpret_cast<Raster::Word*>(dst + i) = rise4(*reinterpret_cast<const Raster::Word*>(below + i),
+                                                              *reinterpret_cast<const Raster::Word*>(below2 + i));
+        }
+    }
+    for (; i < n; i++) {
+        dst[i] = rise(below[i], below2[i]);
+    }
+}
+
+// Step 3. With probability chance/255, ignite a spark in one of the first 7 cells
+inline void spark(byte* h, int len, uint8_t chance, FastRandom& rng) {
+    if (rng.below(255) < chance) {
+        int y = rng.below(len < 7 ? len : 7);
+        h[y] = qadd8(h[y], rng.range(160, 255));
+    }
+}
+
+} // namespace Heat
+
+#endif // HEAT_H
@@ -8,75 +8,80 @@ extern volatile bool triggerRipple;
 
 namespace KineticRipple {
 
-bool rippleActive = false;
-unsigned long rippleStartTime = 0;
-RgbColor rippleColor;
-// REMOVED: The hardcoded rippleWidth and rippleSpeed variables are now in PixelStrip.h
-
-inline void start(PixelStrip::Segment* seg, uint32_t color1, uint32_t color2) {
-    seg->setEffect(PixelStrip::Segment::SegmentEffect::KINETIC_RIPPLE);
-    seg->active = true;
+// Per-segment ripple state and its configurable width/speed
+struct State {
+    float speed = 0.2f;             // The speed/fade duration of the ripple
+    uint32_t startTime = 0;
+    RgbColor color;
+    uint8_t width = 3;              // The width of the ripple in pixels
+    bool rippleActive = false;
+};
+
+// Width in pixels (odd widths center on the ring), speed in pixels per ms (also the fade)
+inline ParamList params() {
+    static const ParamSpec specs[] = {
+        PARAM_COLOR,
+        PARAM_FIELD(State, width, "width", U8, 1, 255),
+        PARAM_FIELD(State, speed, "speed", FLOAT, 1, 10000),
+    };
+    return specs;
+}
+
+inline void start(PixelStrip::Segment* seg, State& st) {
     seg->interval = 5;
-    seg->baseColor = color1;
-    rippleActive = false;
 }
 
-inline void update(PixelStrip::Segment* seg) {
-    if (!seg->active) return;
-    
-    if (triggerRipple && !rippleActive) {
-        rippleActive = true;
-        rippleStartTime = millis();
-        rippleColor = RgbColor((seg->baseColor >> 16) & 0xFF, (seg->baseColor >> 8) & 0xFF, seg->baseColor & 0xFF);
+inline void render(PixelStrip::Segment* seg, State& st, PixelSpan px) {
+    if (triggerRipple && !st.rippleActive) {
+        st.rippleActive = true;
+        st.startTime = millis();
+        st.color = PixelStrip::ColorToRgb(seg->baseColor);
         triggerRipple = false;
     }
 
-    seg->allOff();
+    px.clear();
 
-    if (rippleActive) {
-        float elapsed = millis() - rippleStartTime;
-        // MODIFIED: Read speed from the segment's properties
-        int radius = (int)(elapsed * seg->rippleSpeed);
+    if (st.rippleActive) {
+        float elapsed = millis() - st.startTime;
+        int radius = (int)(elapsed * st.speed);
 
-        int startPixel = seg->startIndex();
-        int endPixel = seg->endIndex();
-        int centerPixel = startPixel + (endPixel - startPixel) / 2;
-        int halfLength = (endPixel - startPixel) / 2;
+        int lastPixel = px.size() - 1;
+        int centerPixel = lastPixel / 2;
+        int halfLength = lastPixel / 2;
 
         if (halfLength == 0) halfLength = 1;
         int brightness = 255 - (radius * 255 / halfLength);
         brightness = constrain(brightness, 0, 255);
-        RgbColor fadedColor = rippleColor;
-        fadedColor.Dim(brightness);
+        RgbColor fadedColor = st.color;
+        fadedColor = fadedColor.Dim(brightness);
 
         int pixel1_center = centerPixel + radius;
         int pixel2_center = centerPixel - radius;
-        // MODIFIED: Read width from the segment's properties
-        int halfWidth = seg->rippleWidth / 2;
+        int halfWidth = st.width / 2;
         bool rippleDrawn = false;
 
         // Draw the first ripple bar (moving right)
-        for (int i = 0; i < seg->rippleWidth; i++) {
+        for (int i = 0; i < st.width; i++) {
             int currentPixel = pixel1_center - halfWidth + i;
-            if (currentPixel >= startPixel && currentPixel <= endPixel) {
-                seg->getParent().getStrip().SetPixelColor(currentPixel, fadedColor);
+            if (px.contains(currentPixel)) {
+                px.set(currentPixel, fadedColor);
                 rippleDrawn = true;
             }
         }
 
         // Draw the second ripple bar (moving left)
         if (pixel1_center != pixel2_center) {
-            for (int i = 0; i < seg->rippleWidth; i++) {
+            for (int i = 0; i < st.width; i++) {
                 int currentPixel = pixel2_center - halfWidth + i;
-                if (currentPixel >= startPixel && currentPixel <= endPixel) {
-                    seg->getParent().getStrip().SetPixelColor(currentPixel, fadedColor);
+                if (px.contains(currentPixel)) {
+                    px.set(currentPixel, fadedColor);
                     rippleDrawn = true;
                 }
             }
         }
 
         if (!rippleDrawn && elapsed > 100) {
-            rippleActive = false;
+            st.rippleActive = false;
         }
     }
 }
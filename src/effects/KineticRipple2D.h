@@ -0,0 +1,115 @@
+#ifndef KINETICRIPPLE2D_H
+#define KINETICRIPPLE2D_H
+
+#include "../PixelStrip.h"
+#include "KineticRipple.h"
+#include <Arduino.h>
+
+extern volatile bool triggerRipple;
+
+// Kinetic Ripple on a 2D grid: a ring expanding from the center of the segment's grid.
+// Every cell's distance from the center is computed once in start(), so a frame is one
+// compare per cell.
+namespace KineticRipple2D {
+
+// Same width/speed settings as the 1D ripple (setripplewidth/setripplespeed apply to both)
+typedef KineticRipple::State State;
+
+// Distance of each cell from the grid center in half pixels, shifted right until the
+// farthest corner fits a byte; a segment uses the cells from its start index
+static uint8_t distance[PIXELSTRIP_LAYER_PIXELS];
+
+// Integer square root (floor)
+inline uint32_t isqrt(uint32_t v) {
+    uint32_t root = 0;
+    for (uint32_t bit = 1UL << 30; bit; bit >>= 2) {
+        if (v >= root + bit) {
+            v -= root + bit;
+            root = (root >> 1) + bit;
+        } else {
+            root >>= 1;
+        }
+    }
+    return root;
+}
+
+// Center-to-corner distance of a grid in half pixels, and the shift that fits it in a byte
+inline uint32_t cornerDistance(const PixelGrid& grid) {
+    uint32_t w = grid.width() - 1, h = grid.height() - 1;
+    return isqrt(w * w + h * h);
+}
+inline uint8_t distanceShift(uint32_t corner) {
+    uint8_t shift = 0;
+    while ((corner >> shift) > 255) shift++;
+    return shift;
+}
+
+inline ParamList params() {
+    return KineticRipple::params();
+}
+
+inline void start(PixelStrip::Segment* seg, State& st) {
+    KineticRipple::start(seg, st);
+
+    PixelGrid grid(seg->renderPixels(), seg->gridWidth(), seg->gridHeight());
+    uint8_t shift = distanceShift(cornerDistance(grid));
+    uint8_t* d = distance + seg->startIndex();
+    for (int y = 0; y < grid.height(); y++) {
+        int32_t dy = 2 * y - (grid.height() - 1); // Doubled, so the center of even sizes is exact
+        for (int x = 0; x < grid.width(); x++) {
+            int32_t dx = 2 * x - (grid.width() - 1);
+            *d++ = isqrt(dx * dx + dy * dy) >> shift;
+        }
+    }
+}
+
+inline void render(PixelStrip::Segment* seg, State& st, PixelSpan px) {
+    if (triggerRipple && !st.rippleActive) {
+        st.rippleActive = true;
+        st.startTime = millis();
+        st.color = PixelStrip::ColorToRgb(seg->baseColor);
+        triggerRipple = false;
+    }
+
+    px.clear();
+
+    if (st.rippleActive) {
+        PixelGrid grid(px, seg->gridWidth(), seg->gridHeight());
+        uint32_t corner = cornerDistance(grid);
+        uint8_t shift = distanceShift(corner);
+        if (corner == 0) corner = 1;
+
+        float elapsed = millis() - st.startTime;
+        int32_t ring = (int32_t)(elapsed * st.speed * 2); // Ring radius in half pixels
+
+        int brightness = 255 - (int)(ring * 255 / (int32_t)corner);
+        brightness = constrain(brightness, 0, 255);
+        RgbColor fadedColor = st.color;
+        fadedColor = fadedColor.Dim(brightness);
+
+        // Cells within width/2 pixels of the ring, in the distance table's units
+        int32_t inner = (ring - st.width) >> shift;
+        int32_t outer = (ring + st.width) >> shift;
+        bool rippleDrawn = inner <= (int32_t)(corner >> shift);
+
+        if (rippleDrawn) {
+            const uint8_t* d = distance + seg->startIndex();
+            for (int y = 0; y < grid.height(); y++) {
+                PixelSpan row = grid.row(y);
+                for (int x = 0; x < grid.width(); x++, d++) {
+                    if (*d >= inner && *d <= outer) {
+                        row.set(x, fadedColor);
+                    }
+                }
+            }
+        }
+
+        if (!rippleDrawn && elapsed > 100) {
+            st.rippleActive = false;
+        }
+    }
+}
+
+} // namespace KineticRipple2D
+
+#endif // KINETICRIPPLE2D_H
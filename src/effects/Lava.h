@@ -0,0 +1,48 @@
+#ifndef LAVA_H
+#define LAVA_H
+
+#include "../PixelStrip.h"
+#include "../Noise.h"
+
+// Slow-moving blobs of molten rock: noise over the segment (or its grid) and time,
+// mapped to a black -> red -> orange -> yellow gradient
+namespace Lava {
+
+// Noise detail and flow rate, kept per segment
+struct State {
+    uint8_t scale = 24; // Lattice steps per pixel, in 1/256 cell (24 = a blob every ~10 px)
+    uint8_t speed = 6;  // Time axis steps per ms, in 1/4096 cell
+};
+
+inline ParamList params() {
+    static const ParamSpec specs[] = {
+        PARAM_FIELD(State, scale, "scale", U8, 1, 255),
+        PARAM_FIELD(State, speed, "speed", U8, 1, 255),
+    };
+    return specs;
+}
+
+inline void start(PixelStrip::Segment* seg, State& st) {
+    seg->interval = 20;
+}
+
+inline void render(PixelStrip::Segment* seg, State& st, PixelSpan px) {
+    PixelGrid grid(px, seg->gridWidth(), seg->gridHeight());
+    uint16_t t = (millis() * st.speed) >> 4;
+    const RgbColor* palette = seg->palette(PaletteBank::LAVA);
+    bool flat = grid.height() == 1; // A strip samples a 2D field (position, time)
+
+    for (int y = 0; y < grid.height(); y++) {
+        PixelSpan row = grid.row(y);
+        uint16_t ys = y * st.scale;
+        uint16_t xs = 0;
+        for (int x = 0; x < grid.width(); x++, xs += st.scale) {
+            uint8_t v = flat ? Noise::noise2(xs, t) : Noise::noise3(xs, ys, t);
+            row.set(x, palette[Noise::stretch(v)]);
+        }
+    }
+}
+
+} // namespace Lava
+
+#endif // LAVA_H
@@ -0,0 +1,54 @@
+#ifndef OCEAN_H
+#define OCEAN_H
+
+#include "../PixelStrip.h"
+#include "../Noise.h"
+
+// Rolling water: two noise fields of different size drifting against each other,
+// averaged and mapped to a deep blue -> blue -> cyan -> foam gradient
+namespace Ocean {
+
+// Wave size and speed, kept per segment
+struct State {
+    uint8_t scale = 40; // Lattice steps per pixel of the fine field, in 1/256 cell
+    uint8_t speed = 10; // Drift per ms, in 1/4096 cell
+};
+
+inline ParamList params() {
+    static const ParamSpec specs[] = {
+        PARAM_FIELD(State, scale, "scale", U8, 1, 255),
+        PARAM_FIELD(State, speed, "speed", U8, 1, 255),
+    };
+    return specs;
+}
+
+inline void start(PixelStrip::Segment* seg, State& st) {
+    seg->interval = 20;
+}
+
+inline void render(PixelStrip::Segment* seg, State& st, PixelSpan px) {
+    PixelGrid grid(px, seg->gridWidth(), seg->gridHeight());
+    uint16_t t = (millis() * st.speed) >> 4;
+    const RgbColor* palette = seg->palette(PaletteBank::OCEAN);
+    bool flat = grid.height() == 1;
+    uint8_t swellScale = st.scale >> 2; // The swell is four times larger than the ripples
+
+    for (int y = 0; y < grid.height(); y++) {
+        PixelSpan row = grid.row(y);
+        uint16_t ys = y * st.scale;
+        uint16_t swellY = y * swellScale;
+        uint16_t xs = 0, swellX = 0;
+        for (int x = 0; x < grid.width(); x++, xs += st.scale, swellX += swellScale) {
+            // Ripples travel one way, the swell the other
+            uint8_t ripple = flat ? Noise::noise2(xs + t, t >> 1) : Noise::noise3(xs + t, ys, t >> 1);
+            uint8_t swell = flat ? Noise::noise2(swellX - (t >> 1), 0x8000 + (t >> 2))
+                                 : Noise::noise3(swellX, swellY - (t >> 1), 0x8000 + (t >> 2));
+            uint8_t v = (ripple + swell + swell) / 3;
+            row.set(x, palette[Noise::stretch(v)]);
+        }
+    }
+}
+
+} // namespace Ocean
+
+#endif // OCEAN_H
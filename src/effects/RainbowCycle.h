@@ -5,46 +5,34 @@
 
 namespace RainbowCycle {
 
+struct State {
+    uint16_t firstPixelHue;
+};
+
+// Parameters: the 'wait' time between frames
+inline ParamList params() {
+    static const ParamSpec specs[] = {PARAM_INTERVAL(1, 1000)};
+    return specs;
+}
+
 /**
  * @brief Initializes the RainbowCycle effect.
- * @param seg The segment to apply the effect to.
- * @param color1 The 'wait' time in milliseconds for the delay. Defaults to 20ms.
- * @param color2 Unused for this effect.
+ * @param seg The segment to apply the effect to. Waits 20ms between frames until `interval` is set.
  */
-inline void start(PixelStrip::Segment* seg, uint32_t color1, uint32_t color2) {
-    seg->setEffect(PixelStrip::Segment::SegmentEffect::RAINBOW_CYCLE);
-    seg->active = true;
-    seg->interval = (color1 > 0) ? color1 : 20; // Use color1 as the 'wait' parameter
+inline void start(PixelStrip::Segment* seg, State& st) {
+    seg->interval = 20;
     seg->lastUpdate = millis();
-    seg->rainbowFirstPixelHue = 0; 
+    st.firstPixelHue = 0;
 }
 
 /**
- * @brief Updates the RainbowCycle effect on each loop, non-blocking.
+ * @brief Renders one RainbowCycle frame; Segment::update() calls it once per interval.
  */
-inline void update(PixelStrip::Segment* seg) {
-    if (!seg->active) return;
-
-    if (millis() - seg->lastUpdate < seg->interval) return;
-    seg->lastUpdate = millis();
-
-    for (uint16_t i = seg->startIndex(); i <= seg->endIndex(); i++) {
-        uint16_t pixelHue = seg->rainbowFirstPixelHue + 
-                           ((i - seg->startIndex()) * 65536L / (seg->endIndex() - seg->startIndex() + 1));
-        
-        uint32_t color = seg->getParent().ColorHSV(pixelHue);
-
-        // --- CORRECTED LINE ---
-        // Manually break the color into R, G, B components before creating the RgbColor object.
-        RgbColor rgbColor((color >> 16) & 0xFF, (color >> 8) & 0xFF, color & 0xFF);
-        seg->getParent().getStrip().SetPixelColor(i, rgbColor);
-    }
-
-    seg->rainbowFirstPixelHue += 256;
+inline void render(PixelStrip::Segment* seg, State& st, PixelSpan px) {
+    // One table lookup per pixel; the rainbow palette unless the segment selects another
+    Raster::paletteRamp(px, seg->palette(PaletteBank::RAINBOW), st.firstPixelHue, Raster::hueStep(px.size()));
 
-    if (seg->rainbowFirstPixelHue >= 5 * 65536) {
-        seg->rainbowFirstPixelHue = 0;
-    }
+    st.firstPixelHue += 256; // Wraps at 65536, one full hue turn
 }
 
 }
@@ -5,50 +5,51 @@
 
 namespace TheaterChase {
 
+struct State {
+    uint16_t hue;
+    uint8_t chaseOffset;
+};
+
+// Parameters: the 'wait' time between frames
+inline ParamList params() {
+    static const ParamSpec specs[] = {PARAM_INTERVAL(1, 1000)};
+    return specs;
+}
+
 /**
  * @brief Initializes the TheaterChase effect.
- * @param seg The segment to apply the effect to.
- * @param color1 The 'wait' time in milliseconds. Defaults to 50ms.
- * @param color2 Unused.
+ * @param seg The segment to apply the effect to. Waits 50ms between frames until `interval` is set.
  */
-inline void start(PixelStrip::Segment* seg, uint32_t color1, uint32_t color2) {
-    seg->setEffect(PixelStrip::Segment::SegmentEffect::THEATER_CHASE);
-    seg->active = true;
-    seg->interval = (color1 > 0) ? color1 : 50; // Use color1 as the 'wait' parameter
+inline void start(PixelStrip::Segment* seg, State& st) {
+    seg->interval = 50;
     seg->lastUpdate = millis();
-    seg->rainbowFirstPixelHue = 0; // Re-using this for the hue state
-    seg->chaseOffset = 0;          // Start the chase from the first pixel
+    st.hue = 0;
+    st.chaseOffset = 0; // Start the chase from the first pixel
 }
 
 /**
- * @brief Updates the TheaterChase effect on each loop, non-blocking.
+ * @brief Renders one TheaterChase frame; Segment::update() calls it once per interval.
  */
-inline void update(PixelStrip::Segment* seg) {
-    if (!seg->active) return;
-
-    // Check if enough time has passed to draw the next frame
-    if (millis() - seg->lastUpdate < seg->interval) return;
-    seg->lastUpdate = millis();
+inline void render(PixelStrip::Segment* seg, State& st, PixelSpan px) {
+    px.clear(); // Clear the segment for this frame
 
-    seg->clear(); // Clear the segment for this frame
+    uint16_t len = px.size();
+    uint32_t step = Raster::hueStep(len);
+    uint32_t hue = ((uint32_t)st.hue << 16) + st.chaseOffset * step; // 16.16 fixed point
 
     // This loop lights up every third pixel, starting from the current offset
-    for (uint16_t i = seg->startIndex() + seg->chaseOffset; i <= seg->endIndex(); i += 3) {
-        // Calculate the hue for this pixel
-        uint16_t hue = seg->rainbowFirstPixelHue + 
-                       (i - seg->startIndex()) * 65536L / (seg->endIndex() - seg->startIndex() + 1);
-        
-        uint32_t color = seg->getParent().ColorHSV(hue);
-        seg->getParent().setPixel(i, color); // Use setPixel to apply brightness
+    for (uint16_t i = st.chaseOffset; i < len; i += 3) {
+        px.set(i, Raster::hueColor(hue >> 16));
+        hue += 3 * step;
     }
     
     // --- Update state for the NEXT frame ---
     
     // Advance the chase offset (0, 1, 2, 0, 1, 2, ...)
-    seg->chaseOffset = (seg->chaseOffset + 1) % 3;
+    st.chaseOffset = (st.chaseOffset + 1) % 3;
 
     // Advance the hue slightly
-    seg->rainbowFirstPixelHue += 65536 / 90;
+    st.hue += 65536 / 90;
 }
 
 }
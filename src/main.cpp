@@ -1,6 +1,12 @@
 #include <Arduino.h>
 #include "PixelStrip.h"
 #include "Triggers.h"
+#include "Profiler.h"
+#include "Debugger.h"
+#include "LoopTelemetry.h"
+#include "MemoryReport.h"
+#include "ModMatrix.h"
+#include "effects/Heat.h"
 #include <PDM.h>
 #include <WiFiNINA.h>
 #include <Arduino_LSM6DSOX.h>
@@ -27,6 +33,7 @@ bool debugAccel = false;
 #define LED_COUNT 300
 #define BRIGHTNESS 25
 #define SEGMENTS 0
+#define POWER_BUDGET_MA 0 // Cap on the estimated LED current; 0 = unlimited
 
 // --- Active Color Variables ---
 uint8_t activeR = 128;
@@ -37,8 +44,17 @@ uint8_t activeB = 128;
 volatile int16_t sampleBuffer[SAMPLES];
 volatile int samplesRead;
 
+// --- LED Outputs ---
+// Chains laid end to end in logical pixel order; add {pin, count} entries (up to
+// PIXELSTRIP_MAX_OUTPUTS) to drive several chains in parallel. strip.pixelCount() is their total.
+constexpr PixelStrip::OutputConfig LED_OUTPUTS[] = {
+    {LED_PIN, LED_COUNT},
+};
+static_assert(PixelStrip::totalLeds(LED_OUTPUTS, sizeof(LED_OUTPUTS) / sizeof(LED_OUTPUTS[0])) <= PIXELSTRIP_LAYER_PIXELS,
+              "LED_OUTPUTS has more LEDs than PIXELSTRIP_LAYER_PIXELS; raise it");
+
 // --- Global Objects ---
-PixelStrip strip(LED_PIN, LED_COUNT, BRIGHTNESS, SEGMENTS);
+PixelStrip strip(LED_OUTPUTS, sizeof(LED_OUTPUTS) / sizeof(LED_OUTPUTS[0]), BRIGHTNESS, SEGMENTS);
 PixelStrip::Segment *seg;
 AudioTrigger<SAMPLES> audioTrigger;
 
@@ -58,6 +74,7 @@ const unsigned long HEARTBEAT_COLOR_CHANGE_INTERVAL = 2000;
 void ledFlashCallback(bool isActive, uint8_t brightness)
 {
     strip.propagateTriggerState(isActive, brightness);
+    MODS.gate(isActive, brightness);
 }
 
 void updateHeartbeat()
@@ -89,13 +106,307 @@ void updateHeartbeat()
     }
 }
 
+void printMemoryReport()
+{
+    MemoryReport::printRuntime(Serial);
+    Serial.println("Static footprint:");
+    MemoryReport::printFootprint(Serial, "FFT (AudioTrigger)", sizeof(audioTrigger));
+    MemoryReport::printFootprint(Serial, "PDM sample buffer", sizeof(sampleBuffer));
+    strip.printMemoryUsage(Serial);
+    MemoryReport::printFootprint(Serial, "Debugger", sizeof(Debugger));
+    MemoryReport::printFootprint(Serial, "Profiler", sizeof(Profiler));
+    MemoryReport::printFootprint(Serial, "Loop telemetry", sizeof(LoopTelemetry));
+    MemoryReport::printFootprint(Serial, "Mod matrix", sizeof(ModMatrix));
+}
+
+void printParamRange(const ParamSpec &spec)
+{
+    Serial.print("Error: ");
+    Serial.print(spec.name);
+    Serial.print(" must be ");
+    Params::print(Serial, spec, spec.min);
+    Serial.print(" to ");
+    Params::print(Serial, spec, spec.max);
+    Serial.println(".");
+}
+
+// Start an effect on the selected segment. The active color (setcolor) goes to its "color"
+// parameter, if it has one; then each value in args goes to the next parameter of its
+// schema, in order (so `fire 120 55` sets sparking and cooling). A 0 keeps the default of a
+// parameter whose range excludes 0, such as an interval.
+void startSelected(PixelStrip::Segment::SegmentEffect effect, const String &args)
+{
+    seg->startEffect(effect);
+    int color = seg->findParam("color");
+    if (color >= 0)
+    {
+        seg->setParam(color, strip.Color(activeR, activeG, activeB));
+    }
+    ParamList list = seg->params();
+    char buf[64];
+    strncpy(buf, args.c_str(), sizeof(buf) - 1);
+    buf[sizeof(buf) - 1] = '\0';
+    uint8_t next = 0;
+    for (char *tok = strtok(buf, " "); tok; tok = strtok(nullptr, " "), ++next)
+    {
+        if (next == color)
+            ++next; // The color is not positional
+        if (next >= list.count)
+            break;
+        const ParamSpec &spec = list.specs[next];
+        int32_t value;
+        if (!Params::parse(spec, tok, value))
+        {
+            printParamRange(spec);
+            continue;
+        }
+        bool keepDefault = value == 0 && (spec.min > 0 || spec.max < 0);
+        if (!keepDefault && !seg->setParam(next, value))
+        {
+            printParamRange(spec);
+        }
+    }
+}
+
+// List the running effect's parameters on a segment: name, type, range and current value
+void printParams(PixelStrip::Segment *target)
+{
+    ParamList list = target->params();
+    Serial.print("Segment ");
+    Serial.print(target->getId());
+    Serial.print(list.count ? " parameters:" : ": no effect parameters");
+    Serial.println();
+    for (uint8_t i = 0; i < list.count; ++i)
+    {
+        const ParamSpec &spec = list.specs[i];
+        Serial.print("  ");
+        Serial.print(i);
+        Serial.print(" ");
+        Serial.print(spec.name);
+        Serial.print(" (");
+        Serial.print(Params::typeName(spec.type));
+        Serial.print(" ");
+        Params::print(Serial, spec, spec.min);
+        Serial.print("..");
+        Params::print(Serial, spec, spec.max);
+        Serial.print(") = ");
+        Params::print(Serial, spec, target->getParam(i));
+        Serial.println();
+    }
+}
+
+// Read one binary parameter batch (see PARAM_FRAME_SYNC) and apply it all or not at all
+void handleParamFrame()
+{
+    uint8_t frame[3 + PARAM_FRAME_MAX * PARAM_RECORD_BYTES + 1];
+    if (Serial.readBytes(frame, 3) != 3 || frame[2] > PARAM_FRAME_MAX)
+    {
+        Serial.println("Param frame: bad header");
+        return;
+    }
+    size_t len = 3 + frame[2] * PARAM_RECORD_BYTES + 1;
+    if (Serial.readBytes(frame + 3, len - 3) != len - 3)
+    {
+        Serial.println("Param frame: truncated");
+        return;
+    }
+    uint8_t check = 0;
+    for (size_t i = 0; i < len - 1; ++i)
+    {
+        check ^= frame[i];
+    }
+    PixelStrip::SegmentList segments = strip.getSegments();
+    if (check != frame[len - 1])
+    {
+        Serial.println("Param frame: checksum mismatch");
+    }
+    else if (frame[1] >= segments.size() || !segments[frame[1]]->setParams(frame + 3, frame[2]))
+    {
+        Serial.println("Param frame: rejected (segment, parameter or range)");
+    }
+    else
+    {
+        Serial.println("Param frame: ok");
+    }
+}
+
+// Cycle segment layouts many times and check that no heap allocation happened.
+// Leaves only segment 0 ("all") behind, like clearsegments.
+#define SOAK_MAX_CYCLES 100000 // Keeps a mistyped count from blocking the loop for hours
+void runSegmentSoak(uint32_t cycles)
+{
+    MemoryReport::AllocCounters before = MemoryReport::allocCounters();
+    uint32_t heapBefore = MemoryReport::heapUsed();
+    char name[SEGMENT_NAME_LEN];
+
+    for (uint32_t c = 0; c < cycles; ++c)
+    {
+        strip.clearUserSegments();
+        MODS.dropSegmentRoutes(1);
+        uint8_t count = 1 + (c % (PIXELSTRIP_MAX_SEGMENTS - 1));
+        uint16_t per = strip.pixelCount() / count;
+        for (uint8_t s = 0; s < count; ++s)
+        {
+            snprintf(name, sizeof(name), "seg%u", (unsigned)(s + 1));
+            strip.addSection(s * per, s * per + per - 1, name);
+        }
+        for (auto *s : strip.getSegments())
+        {
+            s->startEffect(PixelStrip::Segment::SegmentEffect::RAINBOW_CYCLE);
+            s->setParam(s->findParam("interval"), 1);
+        }
+    }
+    strip.clearUserSegments();
+    MODS.dropSegmentRoutes(1);
+    seg = strip.getSegments()[0];
+    seg->startEffect(PixelStrip::Segment::SegmentEffect::NONE);
+
+    MemoryReport::AllocCounters after = MemoryReport::allocCounters();
+    int32_t heapDelta = (int32_t)(MemoryReport::heapUsed() - heapBefore);
+    uint32_t allocs = after.allocs - before.allocs;
+    Serial.print("Soak: ");
+    Serial.print(cycles);
+    Serial.print(" layout cycles, ");
+#if MEMORY_TRACK_ALLOCS
+    Serial.print(allocs);
+    Serial.print(" allocations, heap delta ");
+#else
+    (void)allocs;
+    Serial.print("allocations not counted (build with MEMORY_TRACK_ALLOCS=1), heap delta ");
+#endif
+    Serial.print(heapDelta);
+    Serial.println(allocs == 0 && heapDelta == 0 ? " B -> PASS" : " B -> FAIL");
+}
+
+// Render every effect back to back on the selected segment and print its cost per frame.
+// Given a width (and height for a grid), they render on an offscreen layer of that size
+// instead, so sizes the LEDs don't have can be timed. The profiler is paused meanwhile;
+// the segment is left stopped afterwards.
+void runEffectBenchmark(uint32_t frames, uint16_t width = 0, uint16_t height = 0)
+{
+    if (frames == 0)
+        frames = 1;
+    PixelStrip::Segment *selected = seg;
+    if (width > 0)
+    {
+        uint32_t length = (uint32_t)width * (height ? height : 1);
+        seg = length <= PIXELSTRIP_LAYER_PIXELS ? strip.addOffscreenSection(length, "bench") : nullptr;
+        if (!seg)
+        {
+            seg = selected;
+            Serial.println("Bench: no room for that size (free segments and layer pixels, see 'mem')");
+            return;
+        }
+        seg->setGrid(height ? width : 0, height);
+    }
+    bool profiling = PROF.isEnabled();
+    PROF.setEnabled(false);
+
+    char name[24];
+    char line[64];
+    snprintf(line, sizeof(line), "Bench: %lu frames on segment %u (%u px, grid %ux%u)", (unsigned long)frames,
+             (unsigned)seg->getId(), (unsigned)seg->pixels().size(), (unsigned)seg->gridWidth(),
+             (unsigned)seg->gridHeight());
+    Serial.println(line);
+    for (uint8_t e = 1; e < static_cast<uint8_t>(PixelStrip::Segment::SegmentEffect::EFFECT_COUNT); ++e)
+    {
+        startSelected(static_cast<PixelStrip::Segment::SegmentEffect>(e), "");
+        uint32_t t0 = Profiler::now();
+        for (uint32_t f = 0; f < frames; ++f)
+        {
+            seg->render();
+        }
+        uint32_t us100 = (uint32_t)((uint64_t)(Profiler::now() - t0) * 100 / frames);
+        PROF.siteName(Profiler::effectSite(e), name, sizeof(name));
+        snprintf(line, sizeof(line), "  %-20s %5lu.%02lu us/frame", name, (unsigned long)(us100 / 100),
+                 (unsigned long)(us100 % 100));
+        Serial.println(line);
+    }
+    seg->startEffect(PixelStrip::Segment::SegmentEffect::NONE);
+    if (seg != selected)
+    {
+        strip.removeLastSection();
+        seg = selected;
+    }
+    PROF.setEnabled(profiling);
+}
+
+// Run the word-parallel heat kernels against their per-cell references on random heat,
+// at the given flame lengths, and print whether they match and the cost of each. Every
+// alignment starts from the same heat and seed, so they must also all end alike.
+void runHeatBenchmark(uint32_t frames)
+{
+    static const int lengths[] = {300, 2000};
+    if (frames == 0)
+        frames = 1;
+    char line[96];
+    for (int len : lengths)
+    {
+        byte *fast = new byte[len + 3];
+        byte *ref = new byte[len + 3];
+        byte *aligned = new byte[len]; // Result at offset 0
+        bool match = true;
+        uint32_t fastUs = 0, refUs = 0;
+        for (int offset = 0; offset < 4; ++offset) // Every alignment of the run
+        {
+            FastRandom fill(len), fastRng(1), refRng(1);
+            for (int i = 0; i < len; ++i)
+                fast[offset + i] = ref[offset + i] = fill.next() >> 24;
+            uint16_t k = Heat::coolingRange(55, 10); // A short flame's cooling, so cells often hit 0
+            uint32_t t0 = Profiler::now();
+            for (uint32_t f = 0; f < frames; ++f)
+            {
+                Heat::cool(fast + offset, len, k, fastRng);
+                Heat::drift(fast + offset, len);
+                fast[offset] = Heat::qadd8(fast[offset], 200); // Keep some heat moving
+            }
+            uint32_t t1 = Profiler::now();
+            for (uint32_t f = 0; f < frames; ++f)
+            {
+                Heat::coolReference(ref + offset, len, k, refRng);
+                Heat::driftReference(ref + offset, len);
+                ref[offset] = Heat::qadd8(ref[offset], 200);
+            }
+            uint32_t t2 = Profiler::now();
+            fastUs += t1 - t0;
+            refUs += t2 - t1;
+            match = match && memcmp(fast + offset, ref + offset, len) == 0;
+            if (offset == 0)
+                memcpy(aligned, fast, len);
+            match = match && memcmp(fast + offset, aligned, len) == 0;
+        }
+        uint32_t fast100 = (uint32_t)((uint64_t)fastUs * 100 / (frames * 4));
+        uint32_t ref100 = (uint32_t)((uint64_t)refUs * 100 / (frames * 4));
+        snprintf(line, sizeof(line), "Heat %4d cells: word %lu.%02lu us, per-cell %lu.%02lu us, %s", len,
+                 (unsigned long)(fast100 / 100), (unsigned long)(fast100 % 100), (unsigned long)(ref100 / 100),
+                 (unsigned long)(ref100 % 100), match ? "bit-exact" : "MISMATCH");
+        Serial.println(line);
+        delete[] fast;
+        delete[] ref;
+        delete[] aligned;
+    }
+}
+
 void handleSerial()
 {
     if (Serial.available())
     {
+        PROFILE_SCOPE(Profiler::SITE_SERIAL_CMD);
+        TELEM.noteWork();
+        if (Serial.peek() == PARAM_FRAME_SYNC)
+        {
+            handleParamFrame();
+            return;
+        }
         String cmd_full = Serial.readStringUntil('\n');
         cmd_full.trim();
 
+        // DEBUG / DBGLEVEL commands are handled by the Debugger itself
+        if (DBG.handleCommandLine(cmd_full))
+        {
+            return;
+        }
+
         String cmd_base = cmd_full;
         String cmd_params = "";
 
@@ -111,6 +422,7 @@ void handleSerial()
         {
             Serial.println("Clearing all user-defined segments...");
             strip.clearUserSegments();
+            MODS.dropSegmentRoutes(1);
             seg = strip.getSegments()[0];
             seg->startEffect(PixelStrip::Segment::SegmentEffect::NONE);
             Serial.println("Active segment is now 0 (full strip).");
@@ -124,8 +436,17 @@ void handleSerial()
                 int end = cmd_params.substring(firstSpace + 1).toInt();
                 if (end >= start)
                 {
-                    String name = "seg" + String(strip.getSegments().size());
-                    strip.addSection(start, end, name);
+                    char name[SEGMENT_NAME_LEN];
+                    snprintf(name, sizeof(name), "seg%u", (unsigned)strip.getSegments().size());
+                    if (!strip.addSection(start, end, name))
+                    {
+                        Serial.print("Error: segment limit (");
+                        Serial.print(PIXELSTRIP_MAX_SEGMENTS);
+                        Serial.print(") or layer memory (");
+                        Serial.print(PIXELSTRIP_LAYER_PIXELS);
+                        Serial.println(" px) reached.");
+                        return;
+                    }
                     Serial.print("Added new segment (index ");
                     Serial.print(strip.getSegments().size() - 1);
                     Serial.print(") from pixel ");
@@ -158,6 +479,191 @@ void handleSerial()
                 Serial.println("Invalid segment index.");
             }
         }
+        else if (cmd_base == "setlayer")
+        {
+            if (cmd_params.length() > 0 && isdigit(cmd_params.charAt(0)))
+            {
+                seg->setLayer(constrain(cmd_params.toInt(), 0, 255));
+                Serial.print("Segment layer set to: ");
+                Serial.println(seg->getLayer());
+            }
+            else
+            {
+                Serial.println("Invalid format. Use: setlayer <z>");
+            }
+        }
+        else if (cmd_base == "setgrid")
+        {
+            int width = 0, height = 0;
+            if (sscanf(cmd_params.c_str(), "%d %d", &width, &height) == 2 && width >= 0 && height >= 0 &&
+                seg->setGrid(width, height))
+            {
+                Serial.print("Segment grid set to: ");
+                Serial.print(seg->gridWidth());
+                Serial.print("x");
+                Serial.println(seg->gridHeight());
+            }
+            else
+            {
+                Serial.println("Invalid format. Use: setgrid <w> <h> (w * h within the segment, 0 0 for a strip)");
+            }
+        }
+        else if (cmd_base == "setmirror" || cmd_base == "setrepeat" || cmd_base == "setgroup")
+        {
+            if (cmd_params.length() > 0 && isdigit(cmd_params.charAt(0)))
+            {
+                int value = constrain(cmd_params.toInt(), 0, 255);
+                if (cmd_base == "setmirror")
+                    seg->setMirror(value != 0);
+                else if (cmd_base == "setrepeat")
+                    seg->setRepeat(value);
+                else
+                    seg->setGroup(value);
+                char line[96];
+                snprintf(line, sizeof(line), "Segment modifiers: mirror %s, repeat %u, group %u (renders %u of %u px)",
+                         seg->isMirrored() ? "on" : "off", (unsigned)seg->getRepeat(), (unsigned)seg->getGroup(),
+                         (unsigned)seg->renderPixels().size(), (unsigned)seg->pixels().size());
+                Serial.println(line);
+            }
+            else
+            {
+                Serial.print("Invalid format. Use: ");
+                Serial.print(cmd_base);
+                Serial.println(cmd_base == "setmirror" ? " <0|1>" : " <n>");
+            }
+        }
+        else if (cmd_base == "setseed")
+        {
+            if (cmd_params.length() > 0 && isdigit(cmd_params.charAt(0)))
+            {
+                seg->setSeed(strtoul(cmd_params.c_str(), nullptr, 10));
+                Serial.print("Segment seed set to: ");
+                Serial.println(seg->getSeed());
+            }
+            else
+            {
+                Serial.print("Segment seed: ");
+                Serial.println(seg->getSeed());
+            }
+        }
+        else if (cmd_base == "setphase")
+        {
+            if (cmd_params.length() > 0 && isdigit(cmd_params.charAt(0)))
+            {
+                seg->setPhase(cmd_params.toInt());
+                Serial.print("Segment phase set to: ");
+                Serial.println(seg->getPhase());
+            }
+            else
+            {
+                Serial.println("Invalid format. Use: setphase <pixels>");
+            }
+        }
+        else if (cmd_base == "set")
+        {
+            unsigned id = 0;
+            char name[16], text[24];
+            PixelStrip::SegmentList segments = strip.getSegments();
+            if (sscanf(cmd_params.c_str(), "%u %15s %23s", &id, name, text) != 3)
+            {
+                Serial.println("Invalid format. Use: set <segment> <param> <value> (see 'params')");
+            }
+            else if (id >= segments.size())
+            {
+                Serial.println("Error: no such segment.");
+            }
+            else
+            {
+                PixelStrip::Segment *target = segments[id];
+                int index = target->findParam(name);
+                int32_t value;
+                if (index < 0)
+                {
+                    Serial.println("Error: the running effect has no such parameter (see 'params').");
+                }
+                else if (!Params::parse(target->params().specs[index], text, value) || !target->setParam(index, value))
+                {
+                    printParamRange(target->params().specs[index]);
+                }
+                else
+                {
+                    Serial.print(name);
+                    Serial.print(" set to: ");
+                    Params::print(Serial, target->params().specs[index], target->getParam(index));
+                    Serial.println();
+                }
+            }
+        }
+        else if (cmd_base == "params")
+        {
+            PixelStrip::SegmentList segments = strip.getSegments();
+            unsigned id = cmd_params.length() > 0 ? cmd_params.toInt() : seg->getId();
+            if (id < segments.size())
+            {
+                printParams(segments[id]);
+            }
+            else
+            {
+                Serial.println("Error: no such segment.");
+            }
+        }
+        else if (cmd_base == "sharing")
+        {
+            strip.printSharing(Serial);
+        }
+        else if (cmd_base == "setpalette")
+        {
+            if (cmd_params.length() > 0)
+            {
+                uint8_t slot = PaletteBank::find(cmd_params);
+                if (slot == PaletteBank::NONE && !cmd_params.equalsIgnoreCase("default"))
+                {
+                    Serial.println("Unknown palette. Use a slot number, a built-in name or 'default' (see 'palette').");
+                    return;
+                }
+                seg->setPalette(slot);
+            }
+            Serial.print("Segment palette: ");
+            if (seg->getPalette() == PaletteBank::NONE)
+            {
+                Serial.println("effect default");
+            }
+            else
+            {
+                Serial.print(seg->getPalette());
+                Serial.print(" (");
+                Serial.print(PaletteBank::name(seg->getPalette()));
+                Serial.println(")");
+            }
+        }
+        else if (cmd_base == "setblend")
+        {
+            static const char *const blendNames[] = {
+#define BLEND_MODE_NAME(name, label) label,
+                BLEND_MODE_LIST(BLEND_MODE_NAME)
+#undef BLEND_MODE_NAME
+            };
+            int space = cmd_params.indexOf(' ');
+            String modeName = space == -1 ? cmd_params : cmd_params.substring(0, space);
+            int opacity = space == -1 ? 255 : constrain(cmd_params.substring(space + 1).toInt(), 0, 255);
+            uint8_t mode = 0;
+            while (mode < static_cast<uint8_t>(Raster::BlendMode::COUNT) && !modeName.equalsIgnoreCase(blendNames[mode]))
+            {
+                ++mode;
+            }
+            if (mode < static_cast<uint8_t>(Raster::BlendMode::COUNT))
+            {
+                seg->setBlend(static_cast<Raster::BlendMode>(mode), opacity);
+                Serial.print("Segment blend set to: ");
+                Serial.print(blendNames[mode]);
+                Serial.print(", opacity ");
+                Serial.println(opacity);
+            }
+            else
+            {
+                Serial.println("Invalid format. Use: setblend <replace|add|max|multiply|alpha> [opacity]");
+            }
+        }
         else if (cmd_base == "setcolor")
         {
             int firstSpace = cmd_params.indexOf(' ');
@@ -184,11 +690,15 @@ void handleSerial()
             // Expects 9 integer values: R1 G1 B1 R2 G2 B2 R3 G3 B3
             int r1, g1, b1, r2, g2, b2, r3, g3, b3;
             int n = sscanf(cmd_params.c_str(), "%d %d %d %d %d %d %d %d %d", &r1, &g1, &b1, &r2, &g2, &b2, &r3, &g3, &b3);
-            if (n == 9)
+            if (seg->activeEffect != PixelStrip::Segment::SegmentEffect::COLORED_FIRE)
             {
-                seg->fireColor1 = strip.Color(r1, g1, b1);
-                seg->fireColor2 = strip.Color(r2, g2, b2);
-                seg->fireColor3 = strip.Color(r3, g3, b3);
+                Serial.println("Error: start coloredfire on the selected segment first.");
+            }
+            else if (n == 9)
+            {
+                seg->setParam(seg->findParam("base"), strip.Color(r1, g1, b1));
+                seg->setParam(seg->findParam("middle"), strip.Color(r2, g2, b2));
+                seg->setParam(seg->findParam("tips"), strip.Color(r3, g3, b3));
                 Serial.println("Fire colors updated.");
             }
             else
@@ -219,14 +729,19 @@ void handleSerial()
         }
         else if (cmd_base == "setripplewidth") // --- NEW COMMAND ---
         {
-            if (cmd_params.length() > 0)
+            if (seg->activeEffect != PixelStrip::Segment::SegmentEffect::KINETIC_RIPPLE &&
+                seg->activeEffect != PixelStrip::Segment::SegmentEffect::KINETIC_RIPPLE_2D)
+            {
+                Serial.println("Error: start kineticripple or ripple2d on the selected segment first.");
+            }
+            else if (cmd_params.length() > 0)
             {
                 int new_width = cmd_params.toInt();
-                if (new_width > 0 && new_width % 2 != 0)
+                if (new_width > 0 && new_width < 256 && new_width % 2 != 0)
                 {
-                    seg->rippleWidth = new_width;
+                    seg->setParam(seg->findParam("width"), new_width);
                     Serial.print("Ripple width set to: ");
-                    Serial.println(seg->rippleWidth);
+                    Serial.println(new_width);
                 }
                 else
                 {
@@ -240,18 +755,22 @@ void handleSerial()
         }
         else if (cmd_base == "setripplespeed") // --- NEW COMMAND ---
         {
-            if (cmd_params.length() > 0)
+            if (seg->activeEffect != PixelStrip::Segment::SegmentEffect::KINETIC_RIPPLE &&
+                seg->activeEffect != PixelStrip::Segment::SegmentEffect::KINETIC_RIPPLE_2D)
+            {
+                Serial.println("Error: start kineticripple or ripple2d on the selected segment first.");
+            }
+            else if (cmd_params.length() > 0)
             {
                 float new_speed = cmd_params.toFloat();
-                if (new_speed > 0.0)
+                if (new_speed > 0.0 && seg->setParam(seg->findParam("speed"), (int32_t)(new_speed * 1000.0f + 0.5f)))
                 {
-                    seg->rippleSpeed = new_speed;
                     Serial.print("Ripple speed (fade duration) set to: ");
-                    Serial.println(seg->rippleSpeed);
+                    Serial.println(new_speed);
                 }
                 else
                 {
-                    Serial.println("Error: Speed must be a positive number.");
+                    Serial.println("Error: Speed must be from 0.001 to 10.");
                 }
             }
             else
@@ -259,6 +778,79 @@ void handleSerial()
                 Serial.println("Invalid format. Use: setripplespeed <speed>");
             }
         }
+        else if (cmd_base == "stats")
+        {
+            PROF.handleCommand(cmd_params);
+        }
+        else if (cmd_base == "telemetry")
+        {
+            TELEM.handleCommand(cmd_params);
+        }
+        else if (cmd_base == "power")
+        {
+            strip.power().handleCommand(cmd_params);
+        }
+        else if (cmd_base == "map")
+        {
+            strip.pixelMap().handleCommand(cmd_params);
+        }
+        else if (cmd_base == "mod")
+        {
+            MODS.handleCommand(cmd_params, strip);
+        }
+        else if (cmd_base == "palette")
+        {
+            strip.palettes().handleCommand(cmd_params);
+        }
+        else if (cmd_base == "outputs")
+        {
+            strip.printOutputs(Serial);
+        }
+        else if (cmd_base == "brightness")
+        {
+            if (cmd_params.length() > 0)
+            {
+                long b = cmd_params.toInt();
+                strip.setOutputBrightness(b < 0 ? 0 : b > 255 ? 255 : b);
+            }
+            Serial.print("Output brightness: ");
+            Serial.println(strip.getOutputBrightness());
+        }
+        else if (cmd_base == "soak")
+        {
+            long cycles = cmd_params.length() > 0 ? cmd_params.toInt() : 5000;
+            if (cycles < 1 || cycles > SOAK_MAX_CYCLES)
+            {
+                Serial.print("Error: soak cycles must be 1 to ");
+                Serial.println(SOAK_MAX_CYCLES);
+            }
+            else
+            {
+                runSegmentSoak(cycles);
+            }
+        }
+        else if (cmd_base == "bench")
+        {
+            int frames = 200, width = 0, height = 0;
+            if (cmd_params.length() > 0 &&
+                (sscanf(cmd_params.c_str(), "%d %d %d", &frames, &width, &height) < 1 || frames < 1 || width < 0 ||
+                 height < 0 || width > PIXELSTRIP_LAYER_PIXELS || height > PIXELSTRIP_LAYER_PIXELS))
+            {
+                Serial.println("Invalid format. Use: bench [frames] [width] [height]");
+            }
+            else
+            {
+                runEffectBenchmark(frames, width, height);
+            }
+        }
+        else if (cmd_base == "heatbench")
+        {
+            runHeatBenchmark(cmd_params.length() > 0 ? cmd_params.toInt() : 200);
+        }
+        else if (cmd_base == "mem")
+        {
+            printMemoryReport();
+        }
         else if (cmd_base == "debugaccel")
         {
             debugAccel = !debugAccel;
@@ -267,92 +859,58 @@ void handleSerial()
         }
         else if (cmd_base == "bassflash")
         {
-            seg->startEffect(PixelStrip::Segment::SegmentEffect::FLASH_TRIGGER, strip.Color(activeR, activeG, activeB));
+            startSelected(PixelStrip::Segment::SegmentEffect::FLASH_TRIGGER, cmd_params);
         }
         else if (cmd_base == "solid")
         {
-            seg->startEffect(PixelStrip::Segment::SegmentEffect::SOLID, strip.Color(activeR, activeG, activeB));
+            startSelected(PixelStrip::Segment::SegmentEffect::SOLID, cmd_params);
         }
         else if (cmd_base == "rainbow" || cmd_base == "stop")
         {
-            seg->startEffect(PixelStrip::Segment::SegmentEffect::RAINBOW);
+            startSelected(PixelStrip::Segment::SegmentEffect::RAINBOW, cmd_params);
         }
         else if (cmd_base == "kineticripple")
         {
-            seg->startEffect(PixelStrip::Segment::SegmentEffect::KINETIC_RIPPLE, strip.Color(activeR, activeG, activeB));
+            startSelected(PixelStrip::Segment::SegmentEffect::KINETIC_RIPPLE, cmd_params);
             Serial.println("Starting Kinetic Ripple effect.");
         }
-        else if (cmd_base == "fire" || cmd_base == "flare")
+        else if (cmd_base == "ripple2d")
         {
-            uint32_t p1 = 0, p2 = 0;
-            int space_idx = cmd_params.indexOf(' ');
-            if (cmd_params.length() > 0)
-            {
-                if (space_idx != -1)
-                {
-                    p1 = cmd_params.substring(0, space_idx).toInt();
-                    p2 = cmd_params.substring(space_idx + 1).toInt();
-                }
-                else
-                {
-                    p1 = cmd_params.toInt();
-                }
-            }
-            if (cmd_base == "fire")
-                seg->startEffect(PixelStrip::Segment::SegmentEffect::FIRE, p1, p2);
-            else
-                seg->startEffect(PixelStrip::Segment::SegmentEffect::FLARE, p1, p2);
+            startSelected(PixelStrip::Segment::SegmentEffect::KINETIC_RIPPLE_2D, cmd_params);
+            Serial.println("Starting 2D Kinetic Ripple effect.");
+        }
+        else if (cmd_base == "fire" || cmd_base == "flare" || cmd_base == "fire2d")
+        {
+            startSelected(cmd_base == "fire"     ? PixelStrip::Segment::SegmentEffect::FIRE
+                          : cmd_base == "fire2d" ? PixelStrip::Segment::SegmentEffect::FIRE_2D
+                                                 : PixelStrip::Segment::SegmentEffect::FLARE,
+                          cmd_params);
+        }
+        else if (cmd_base == "lava" || cmd_base == "ocean")
+        {
+            startSelected(cmd_base == "lava" ? PixelStrip::Segment::SegmentEffect::LAVA
+                                             : PixelStrip::Segment::SegmentEffect::OCEAN,
+                          cmd_params);
         }
         else if (cmd_base == "coloredfire")
         {
-            seg->startEffect(PixelStrip::Segment::SegmentEffect::COLORED_FIRE, 0, 0);
+            startSelected(PixelStrip::Segment::SegmentEffect::COLORED_FIRE, cmd_params);
             Serial.println("Starting Colored Fire effect.");
         }
         else if (cmd_base == "rainbowcycle" || cmd_base == "theaterchase")
         {
-            uint32_t p1 = 0;
-            if (cmd_params.length() > 0)
-            {
-                p1 = cmd_params.toInt();
-            }
-            if (cmd_base == "rainbowcycle")
-                seg->startEffect(PixelStrip::Segment::SegmentEffect::RAINBOW_CYCLE, p1);
-            else
-                seg->startEffect(PixelStrip::Segment::SegmentEffect::THEATER_CHASE, p1);
+            startSelected(cmd_base == "rainbowcycle" ? PixelStrip::Segment::SegmentEffect::RAINBOW_CYCLE
+                                                     : PixelStrip::Segment::SegmentEffect::THEATER_CHASE,
+                          cmd_params);
         }
         else if (cmd_base == "next")
         {
-            int current_val = static_cast<int>(seg->activeEffect);
-            int next_val = current_val + 1;
+            int next_val = static_cast<int>(seg->activeEffect) + 1;
             if (next_val >= static_cast<int>(PixelStrip::Segment::SegmentEffect::EFFECT_COUNT))
             {
                 next_val = 1;
             }
-            auto next_effect = static_cast<PixelStrip::Segment::SegmentEffect>(next_val);
-
-            switch (next_effect)
-            {
-            case PixelStrip::Segment::SegmentEffect::SOLID:
-            case PixelStrip::Segment::SegmentEffect::ACCEL_METER:
-            case PixelStrip::Segment::SegmentEffect::KINETIC_RIPPLE:
-            case PixelStrip::Segment::SegmentEffect::FLASH_TRIGGER:
-                seg->startEffect(next_effect, strip.Color(activeR, activeG, activeB));
-                break;
-            case PixelStrip::Segment::SegmentEffect::RAINBOW_CYCLE:
-                seg->startEffect(next_effect, 10);
-                break;
-            case PixelStrip::Segment::SegmentEffect::THEATER_CHASE:
-                seg->startEffect(next_effect, 50);
-                break;
-            case PixelStrip::Segment::SegmentEffect::FIRE:
-            case PixelStrip::Segment::SegmentEffect::FLARE:
-            case PixelStrip::Segment::SegmentEffect::COLORED_FIRE:
-                seg->startEffect(next_effect, 0, 0);
-                break;
-            default:
-                seg->startEffect(next_effect);
-                break;
-            }
+            startSelected(static_cast<PixelStrip::Segment::SegmentEffect>(next_val), "");
         }
     }
 }
@@ -366,6 +924,7 @@ void onPDMdata()
 
 void setup()
 {
+    MemoryReport::paintStack();
     Serial.begin(115200);
     while (!Serial);
 
@@ -397,6 +956,15 @@ void setup()
     }
 
     strip.begin();
+    strip.power().setBudget(POWER_BUDGET_MA);
+    if (strip.droppedPixels())
+    {
+        Serial.print("Error: the outputs exceed PIXELSTRIP_LAYER_PIXELS (");
+        Serial.print(PIXELSTRIP_LAYER_PIXELS);
+        Serial.print("); the last ");
+        Serial.print(strip.droppedPixels());
+        Serial.println(" LEDs are not driven.");
+    }
 
     seg = strip.getSegments()[0];
     seg->begin();
@@ -405,17 +973,24 @@ void setup()
 
 void loop()
 {
+    TELEM.beginIteration();
     handleSerial();
 
     if (samplesRead > 0)
     {
+        PROFILE_SCOPE(Profiler::SITE_FFT);
+        TELEM.noteWork();
         audioTrigger.update(sampleBuffer);
+        MODS.setAudio(audioTrigger.level(0), audioTrigger.level(1), audioTrigger.level(2), audioTrigger.beat());
         samplesRead = 0;
     }
 
     if (IMU.accelerationAvailable())
     {
+        PROFILE_SCOPE(Profiler::SITE_IMU);
+        TELEM.noteWork();
         IMU.readAcceleration(accelX, accelY, accelZ);
+        MODS.setMotion(accelX, accelY, accelZ);
 
         float magnitude = sqrt(accelX * accelX + accelY * accelY + accelZ * accelZ);
 
@@ -437,10 +1012,18 @@ void loop()
 
     updateHeartbeat();
 
-    for (auto *s : strip.getSegments())
     {
-        s->update();
+        PROFILE_SCOPE(Profiler::SITE_MODS);
+        MODS.evaluate(strip, millis());
     }
+    if (strip.update())
+    {
+        TELEM.noteWork();
+    }
+
+    TELEM.noteShow(strip.show());
 
-    strip.show();
+    // Lowest-priority work: flush buffered DBG_LOG output
+    DBG.drain();
+    TELEM.endIteration();
 }
\ No newline at end of file